@@ -4,13 +4,18 @@
 # Adopted from CS 241 @ The University of Illinois
 
 for $file (<examples/*>){
-	if( $file =~ /proc(\d+)-c(\d+)-(\w+)\.out/){
+	# An optional suffix gives the per-core queue balancing (-p), as in proc4-c2-fcfs-push5.out
+	if( $file =~ /proc(\d+)-c(\d+)-(\w+?)(?:-(none|steal|push\d+))?\.out/){
 	#	print "Proc $1 CORE $2 Proc $3\n";
-		`./simulator -c $2 -s $3 examples/proc$1.csv | tail -7 > output1`;
+		$balancing = $4 ? "-p $4" : "";
 		`tail -7 $file > output2`;
-		$diff = `diff output1 output2`;
-		if($diff){
-			print "Test file $file differs\n$diff";
+		# Streaming (-S) must give the same results as the tick loop
+		for $mode ("", "-S"){
+			`./simulator -c $2 -s $3 $balancing $mode examples/proc$1.csv | tail -7 > output1`;
+			$diff = `diff output1 output2`;
+			if($diff){
+				print "Test file $file differs" . ($mode ? " with $mode" : "") . "\n$diff";
+			}
 		}
 	}
 }
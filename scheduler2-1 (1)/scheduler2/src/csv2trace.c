@@ -0,0 +1,120 @@
+/** @file csv2trace.c
+
+  Converts a CSV trace, as read by the simulator, into a binary trace (see
+  trace_header_t) that the simulator maps without parsing it.
+
+  The CSV is read once per column, so the conversion only ever holds one
+  buffer of values, however long the trace is.
+
+  Usage: csv2trace <input csv> <output trace>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libtrace/libtrace.h"
+
+#define CONVERT_BUFFER 4096
+
+static int flush_values(int32_t *buffer, int used, FILE *out, uint64_t *hash)
+{
+  *hash = trace_checksum(*hash, buffer, used);
+  return fwrite(buffer, sizeof(int32_t), used, out) == (size_t)used ? 0 : -2;
+}
+
+/**
+  Writes one column of the trace, adding it to the checksum.
+
+  @return 0 on success
+  @return -1 if the trace holds a line that is not a job
+  @return -2 if the output cannot be written
+ */
+static int write_column(trace_t *t, int column, FILE *out, uint64_t *hash)
+{
+  int32_t buffer[CONVERT_BUFFER];
+  int used = 0, result;
+  trace_job_t job;
+
+  trace_rewind(t);
+  while((result = trace_next(t, &job)) != 0)
+  {
+    if(result == -1)
+      return -1;
+
+    if(column == 0)
+      buffer[used++] = job.arrival_time;
+    else if(column == 1)
+      buffer[used++] = job.run_time;
+    else if(column == 2)
+      buffer[used++] = job.priority;
+    else
+      buffer[used++] = job.deadline;
+
+    if(used == CONVERT_BUFFER)
+    {
+      if(flush_values(buffer, used, out, hash) != 0)
+        return -2;
+      used = 0;
+    }
+  }
+  return flush_values(buffer, used, out, hash);
+}
+
+int main(int argc, char **argv)
+{
+  trace_t trace;
+  trace_header_t header;
+  int column, result = 0;
+
+  if(argc != 3)
+  {
+    fprintf(stderr, "Usage: %s <input csv> <output trace>\n", argv[0]);
+    return 1;
+  }
+
+  if(trace_open(&trace, argv[1]) != 0)
+  {
+    fprintf(stderr, "Unable to open file \"%s\".\n", argv[1]);
+    return 2;
+  }
+
+  FILE *out = fopen(argv[2], "wb");
+  if(out == NULL)
+  {
+    fprintf(stderr, "Unable to open file \"%s\".\n", argv[2]);
+    trace_close(&trace);
+    return 2;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.columns = trace.deadlines ? TRACE_COLUMNS : TRACE_BASE_COLUMNS;
+  header.count = trace_count(&trace);
+  header.checksum = TRACE_CHECKSUM_SEED;
+
+  // The header is written again once the checksum is known
+  if(fwrite(&header, sizeof(header), 1, out) != 1)
+    result = -2;
+  for(column = 0; column < (int)header.columns && result == 0; column++)
+    result = write_column(&trace, column, out, &header.checksum);
+
+  if(result == 0 && (fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1))
+    result = -2;
+  if(fclose(out) != 0 && result == 0)
+    result = -2;
+  trace_close(&trace);
+
+  if(result != 0)
+  {
+    if(result == -1)
+      fprintf(stderr, "Illegal file format.\n");
+    else
+      fprintf(stderr, "Unable to write file \"%s\".\n", argv[2]);
+    remove(argv[2]);
+    return 2;
+  }
+
+  return 0;
+}
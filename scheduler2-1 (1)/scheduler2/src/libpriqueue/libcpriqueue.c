@@ -0,0 +1,213 @@
+/** @file libcpriqueue.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "libcpriqueue.h"
+
+/* Offers try this many shards without blocking before waiting on one. */
+#define OFFER_ATTEMPTS 4
+
+
+/**
+  Per-thread xorshift generator used to spread operations over shards.
+ */
+static unsigned int next_random()
+{
+  static __thread unsigned int state = 0;
+  if(state == 0)
+    state = (unsigned int)(size_t)&state | 1;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+
+/**
+  Picks the better of two shard heads, preferring a when they tie.
+  Returns -1 if both shards are empty.
+ */
+static int better_shard(cpriqueue_t *q, int a, int b)
+{
+  void* pa = priqueue_peek(&q->shards[a].queue);
+  void* pb = priqueue_peek(&q->shards[b].queue);
+  if(pa == NULL)
+    return pb == NULL ? -1 : b;
+  if(pb == NULL || q->comp(pa, pb) <= 0)
+    return a;
+  return b;
+}
+
+
+/**
+  Initializes the cpriqueue_t data structure.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  @param shards the number of independently locked heaps, usually about
+  twice the number of threads sharing q
+ */
+void cpriqueue_init(cpriqueue_t *q, int(*comparer)(const void *, const void *), int shards)
+{
+  if(shards < 1)
+    shards = 1;
+
+  q->shards = aligned_alloc(_Alignof(cpriqueue_shard_t), shards * sizeof(cpriqueue_shard_t));
+  if(q->shards == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    exit(2);
+  }
+  q->num_shards = shards;
+  q->comp = comparer;
+  q->size = 0;
+
+  int i;
+  for(i = 0; i < shards; i++)
+  {
+    pthread_mutex_init(&q->shards[i].lock, NULL);
+    priqueue_init_backend(&q->shards[i].queue, comparer, PRIQUEUE_HEAP);
+  }
+}
+
+
+/**
+  Inserts the specified element into a randomly chosen shard, preferring
+  shards no other thread holds.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @return The zero-based index where ptr is stored within its shard, where 0 indicates that ptr is at the front of that shard.
+ */
+int cpriqueue_offer(cpriqueue_t *q, void *ptr)
+{
+  cpriqueue_shard_t* shard = &q->shards[next_random() % q->num_shards];
+
+  int attempt = 1;
+  while(pthread_mutex_trylock(&shard->lock) != 0)
+  {
+    shard = &q->shards[next_random() % q->num_shards];
+    if(++attempt == OFFER_ATTEMPTS)
+    {
+      pthread_mutex_lock(&shard->lock);
+      break;
+    }
+  }
+
+  /* Counted before the unlock, so a poller that takes ptr counts it down
+     only after it was counted up, and the size never goes negative. */
+  int index = priqueue_offer(&shard->queue, ptr);
+  __atomic_add_fetch(&q->size, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&shard->lock);
+  return index;
+}
+
+
+/**
+  Retrieves, but does not remove, the best head over all shards. Other
+  threads may poll the element before the caller uses it.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @return pointer to element at the head of the queue
+  @return NULL if the queue is empty
+ */
+void *cpriqueue_peek(cpriqueue_t *q)
+{
+  void* best = NULL;
+
+  int i;
+  for(i = 0; i < q->num_shards; i++)
+  {
+    pthread_mutex_lock(&q->shards[i].lock);
+    void* head = priqueue_peek(&q->shards[i].queue);
+    if(head != NULL && (best == NULL || q->comp(head, best) < 0))
+      best = head;
+    pthread_mutex_unlock(&q->shards[i].lock);
+  }
+  return best;
+}
+
+
+/**
+  Retrieves and removes the better head of two randomly chosen shards. Only
+  when both are empty are the remaining shards searched, so NULL means the
+  queue was empty at the time each shard was checked.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @return the head of one of the shards
+  @return NULL if this queue is empty
+ */
+void *cpriqueue_poll(cpriqueue_t *q)
+{
+  int start = next_random() % q->num_shards;
+  void* ptr = NULL;
+
+  if(q->num_shards > 1)
+  {
+    int other = next_random() % (q->num_shards - 1);
+    if(other >= start)
+      other++;
+
+    /* Lock in index order so two pollers cannot deadlock. */
+    int lo = start < other ? start : other;
+    int hi = start < other ? other : start;
+    pthread_mutex_lock(&q->shards[lo].lock);
+    pthread_mutex_lock(&q->shards[hi].lock);
+
+    int best = better_shard(q, start, other);
+    if(best != -1)
+      ptr = priqueue_poll(&q->shards[best].queue);
+
+    pthread_mutex_unlock(&q->shards[hi].lock);
+    pthread_mutex_unlock(&q->shards[lo].lock);
+  }
+
+  int i;
+  for(i = 0; ptr == NULL && i < q->num_shards; i++)
+  {
+    cpriqueue_shard_t* shard = &q->shards[(start + i) % q->num_shards];
+    pthread_mutex_lock(&shard->lock);
+    ptr = priqueue_poll(&shard->queue);
+    pthread_mutex_unlock(&shard->lock);
+  }
+
+  if(ptr != NULL)
+    __atomic_sub_fetch(&q->size, 1, __ATOMIC_RELAXED);
+  return ptr;
+}
+
+
+/**
+  Returns the number of elements in the queue. The count may be stale by
+  the time the caller reads it.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @return the number of elements in the queue
+ */
+int cpriqueue_size(cpriqueue_t *q)
+{
+  return __atomic_load_n(&q->size, __ATOMIC_RELAXED);
+}
+
+
+/**
+  Destroys and frees all the memory associated with q. No other thread may
+  be using q.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+ */
+void cpriqueue_destroy(cpriqueue_t *q)
+{
+  int i;
+  for(i = 0; i < q->num_shards; i++)
+  {
+    priqueue_destroy(&q->shards[i].queue);
+    pthread_mutex_destroy(&q->shards[i].lock);
+  }
+  free(q->shards);
+  q->shards = NULL;
+  q->num_shards = 0;
+  q->size = 0;
+}
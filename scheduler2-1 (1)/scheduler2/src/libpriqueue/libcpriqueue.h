@@ -0,0 +1,45 @@
+/** @file libcpriqueue.h
+ */
+
+#ifndef LIBCPRIQUEUE_H_
+#define LIBCPRIQUEUE_H_
+
+#include <pthread.h>
+
+#include "libpriqueue.h"
+
+/**
+  One lock-protected heap of a cpriqueue_t, padded to its own cache line
+*/
+typedef struct _cpriqueue_shard_t
+{
+  pthread_mutex_t lock;
+  priqueue_t queue;
+} __attribute__((aligned(64))) cpriqueue_shard_t;
+
+/**
+  Concurrent Priqueue Data Structure
+
+  A relaxed priority queue spread over several shards. Any number of threads
+  may offer and poll at once; a poll returns one of the best elements rather
+  than always the single best one.
+*/
+typedef struct _cpriqueue_t
+{
+  cpriqueue_shard_t* shards;
+  int num_shards;
+  int(*comp)(const void *, const void *);
+  int size;
+} cpriqueue_t;
+
+
+void   cpriqueue_init    (cpriqueue_t *q, int(*comparer)(const void *, const void *), int shards);
+
+int    cpriqueue_offer   (cpriqueue_t *q, void *ptr);
+void * cpriqueue_peek    (cpriqueue_t *q);
+void * cpriqueue_poll    (cpriqueue_t *q);
+int    cpriqueue_size    (cpriqueue_t *q);
+
+void   cpriqueue_destroy (cpriqueue_t *q);
+
+#endif /* LIBCPRIQUEUE_H_ */
@@ -1,259 +1,1265 @@
-/** @file libpriqueue.c
- */
-
-#include <stdlib.h>
-#include <stdio.h>
-
-#include "libpriqueue.h"
-
-//courtesy of Job @ http://stackoverflow.com/questions/3599160/unused-parameter-warnings-in-c-code
-#define UNUSED(x) (void)(x)
-
-/**
-  Initializes the priqueue_t data structure.
-
-  Assumtions
-    - You may assume this function will only be called once per instance of priqueue_t
-    - You may assume this function will be the first function called using an instance of priqueue_t.
-  @param q a pointer to an instance of the priqueue_t data structure
-  @param comparer a function pointer that compares two elements.
-  See also @ref comparer-page
- */
-void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
-{
-  q->root = 0;
-  q->size = 0;
-  q->comp = comparer;
-}
-
-
-/**
-  Inserts the specified element into this priority queue.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @param ptr a pointer to the data to be inserted into the priority queue
-  @return The zero-based index where ptr is stored in the priority queue, where 0 indicates that ptr was stored at the front of the priority queue.
- */
-int priqueue_offer(priqueue_t *q, void *ptr)
-{
-  Node* node = malloc(sizeof(Node));
-  node->pointer = ptr;
-  node->next = 0;
-  if(q->size == 0)
-  {
-    q->size = 1;
-    q->root = node;
-
-    return 0;
-  }
-  Node* temp = q->root;
-  Node* parent = 0;
-
-  int num = 0;
-  while(temp != 0 && q->comp(temp->pointer,ptr) < 0)
-  {
-    parent = temp;
-    temp = temp->next;
-    num++;
-  }
-  if(num == 0)
-  {
-    q->size++;
-    node->next = q->root;
-    q->root = node;
-    return 0;
-  }
-
-  parent->next = node;
-  node->next = temp;
-
-  q->size++;
-	return num;
-}
-
-
-/**
-  Retrieves, but does not remove, the head of this queue, returning NULL if
-  this queue is empty.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @return pointer to element at the head of the queue
-  @return NULL if the queue is empty
- */
-void *priqueue_peek(priqueue_t *q)
-{
-  if(q->size == 0) {
-    return NULL;
-  } else {
-    return q->root->pointer;
-  }
-}
-
-
-/**
-  Retrieves and removes the head of this queue, or NULL if this queue
-  is empty.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @return the head of this queue
-  @return NULL if this queue is empty
- */
-void *priqueue_poll(priqueue_t *q)
-{
-  if(q->size == 0) {
-    return NULL;
-  }
-  Node *temp = q->root;
-  void* ptr = 0;
-  if(temp != 0)
-  {
-    q->root = temp->next;
-  }
-  else
-  {
-    q->root = 0;
-  }
-  ptr = temp->pointer;
-  free(temp);
-  q->size--;
-  return ptr;
-}
-
-
-/**
-  Returns the element at the specified position in this list, or NULL if
-  the queue does not contain an index'th element.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @param index position of retrieved element
-  @return the index'th element in the queue
-  @return NULL if the queue does not contain the index'th element
- */
-void *priqueue_at(priqueue_t *q, int index)
-{
-  if(index >= q->size) {
-    return 0;
-  } else {
-    Node* temp = q->root;
-
-    int i = 1;
-    while(i <= index) {
-      temp = temp->next;
-      i++;
-    }
-
-    return temp->pointer;
-  }
-}
-
-
-/**
-  Removes all instances of ptr from the queue.
-
-  This function should not use the comparer function,
-  but check if the data contained in each element of the queue is equal (==) to ptr.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @param ptr address of element to be removed
-  @return the number of entries removed
- */
-int priqueue_remove(priqueue_t *q, void *ptr)
-{
-  if(q->size < 1)
-  {
-    return 0;
-  }
-
-
-  if(q->comp(ptr,q->root->pointer) == 0)
-  {
-    q->size--;
-    Node* temp = q->root;
-    q->root = q->root->next;
-    free(temp);
-    return 1 + priqueue_remove(q,ptr);
-  }
-
-  Node* current = q->root->next;
-  Node* parent = q->root;
-
-  int num = 0;
-  while(current != 0) {
-    if(q->comp(current->pointer,ptr) == 0) {
-      Node* temp = current->next;
-      parent->next = temp;
-      num++;
-      free(current);
-      current = temp;
-      q->size--;
-    } else {
-      parent = current;
-      current = current->next;
-    }
-  }
-	return num;
-}
-
-
-/**
-  Removes the specified index from the queue, moving later elements up
-  a spot in the queue to fill the gap.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @param index position of element to be removed
-  @return the element removed from the queue
-  @return NULL if the specified index does not exist
- */
-void *priqueue_remove_at(priqueue_t *q, int index)
-{
-  if(index > q->size - 1)
-    return 0;
-
-  q->size--;
-
-  Node* temp = q->root;
-
-  if(index == 0)
-  {
-    q->root = q->root->next;
-    return temp;
-  }
-  Node* parent = temp;
-  temp = temp->next;
-  index--;
-  while(index > 0)
-  {
-    parent = temp;
-    temp = temp->next;
-    index--;
-  }
-  parent->next = temp->next;
-	return temp;
-}
-
-
-/**
-  Returns the number of elements in the queue.
-
-  @param q a pointer to an instance of the priqueue_t data structure
-  @return the number of elements in the queue
- */
-int priqueue_size(priqueue_t *q)
-{
-  return q->size;
-}
-
-
-/**
-  Destroys and frees all the memory associated with q.
-
-  @param q a pointer to an instance of the priqueue_t data structure
- */
-void priqueue_destroy(priqueue_t *q)
-{
-  while(q->size > 0)
-  {
-    void* temp = priqueue_remove_at(q,0);
-    free(temp);
-  }
-}
+/** @file libpriqueue.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "libpriqueue.h"
+
+//courtesy of Job @ http://stackoverflow.com/questions/3599160/unused-parameter-warnings-in-c-code
+#define UNUSED(x) (void)(x)
+
+#define HEAP_INITIAL_CAPACITY 16
+#define BUCKET_INITIAL_COUNT 64
+#define BUCKET_OVERFLOW PRIQUEUE_BUCKET_LIMIT
+
+#define IS_HEAP(q) ((q)->backend == PRIQUEUE_HEAP || (q)->backend == PRIQUEUE_INDEXED_HEAP)
+#define LINK(q, ptr) ((priqueue_link_t*)((char*)(ptr) + (q)->link_offset))
+
+/**
+  A block of list nodes allocated in one call. Slabs are only returned to
+  the system by priqueue_destroy; in between, nodes cycle through the
+  queue's free list.
+ */
+typedef struct _priqueue_slab_t
+{
+  struct _priqueue_slab_t* next;
+  Node nodes[PRIQUEUE_SLAB_NODES];
+} priqueue_slab_t;
+
+
+/*
+  Every change to the list allocates or frees a node, so both drop the
+  cursor priqueue_at keeps. An intrusive queue uses the node in the
+  element's link instead.
+ */
+static Node* node_alloc(priqueue_t *q, void *ptr)
+{
+  q->cursor = 0;
+
+  if(q->intrusive)
+  {
+    priqueue_link_t* link = LINK(q, ptr);
+    link->owner = q;
+    link->node.pointer = ptr;
+    return &link->node;
+  }
+
+  Node* node = q->free_nodes;
+  if(node != 0)
+  {
+    q->free_nodes = node->next;
+    q->pool_hits++;
+    node->pointer = ptr;
+    return node;
+  }
+
+  if(q->fresh_left == 0)
+  {
+    priqueue_slab_t* slab = malloc(sizeof(priqueue_slab_t));
+    if(slab == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      exit(2);
+    }
+    slab->next = q->slabs;
+    q->slabs = slab;
+    q->fresh = slab->nodes;
+    q->fresh_left = PRIQUEUE_SLAB_NODES;
+  }
+
+  q->pool_misses++;
+  q->fresh_left--;
+  q->fresh->pointer = ptr;
+  return q->fresh++;
+}
+
+static void node_free(priqueue_t *q, Node* node)
+{
+  q->cursor = 0;
+
+  if(q->intrusive)
+  {
+    ((priqueue_link_t*)node)->owner = 0;
+    return;
+  }
+
+  node->next = q->free_nodes;
+  q->free_nodes = node;
+}
+
+/* Records prev as the node before node, which intrusive lists keep. */
+static void list_set_prev(priqueue_t *q, Node* node, Node* prev)
+{
+  if(q->intrusive && q->backend == PRIQUEUE_LIST && node != 0)
+    ((priqueue_link_t*)node)->prev = prev;
+}
+
+/* Unlinks node from the list, where prev is the node before it or NULL. */
+static void list_unlink(priqueue_t *q, Node* prev, Node* node)
+{
+  if(prev == 0)
+    q->root = node->next;
+  else
+    prev->next = node->next;
+  list_set_prev(q, node->next, prev);
+  node_free(q, node);
+  q->size--;
+}
+
+
+/**
+  Maps an element to its bucket. Negative keys go to bucket 0, and keys
+  of PRIQUEUE_BUCKET_LIMIT or more to the overflow list, BUCKET_OVERFLOW,
+  which comes after every bucket. The order stays correct since each
+  bucket, and the overflow list, is still sorted by the comparer.
+ */
+static int bucket_of(priqueue_t *q, void *ptr)
+{
+  int key = q->key(ptr);
+  if(key < 0)
+    return 0;
+  if(key >= PRIQUEUE_BUCKET_LIMIT)
+    return BUCKET_OVERFLOW;
+  return key;
+}
+
+static Node** bucket_head(priqueue_t *q, int b)
+{
+  return b == BUCKET_OVERFLOW ? &q->overflow_head : &q->bucket_heads[b];
+}
+
+static Node** bucket_tail(priqueue_t *q, int b)
+{
+  return b == BUCKET_OVERFLOW ? &q->overflow_tail : &q->bucket_tails[b];
+}
+
+/* The bucket after b, ending with the overflow list, or -1 after that. */
+static int bucket_next(priqueue_t *q, int b)
+{
+  if(b == -1 || b == BUCKET_OVERFLOW)
+    return -1;
+  return b + 1 < q->num_buckets ? b + 1 : BUCKET_OVERFLOW;
+}
+
+static void bucket_reserve(priqueue_t *q, int bucket)
+{
+  if(bucket < q->num_buckets || bucket == BUCKET_OVERFLOW)
+    return;
+
+  int count = q->num_buckets ? q->num_buckets : BUCKET_INITIAL_COUNT;
+  while(count <= bucket)
+    count *= 2;
+  if(count > PRIQUEUE_BUCKET_LIMIT)
+    count = PRIQUEUE_BUCKET_LIMIT;
+
+  Node** heads = realloc(q->bucket_heads, count * sizeof(Node*));
+  Node** tails = realloc(q->bucket_tails, count * sizeof(Node*));
+  if(heads == NULL || tails == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    exit(2);
+  }
+
+  int i;
+  for(i = q->num_buckets; i < count; i++)
+  {
+    heads[i] = 0;
+    tails[i] = 0;
+  }
+  q->bucket_heads = heads;
+  q->bucket_tails = tails;
+  q->num_buckets = count;
+}
+
+/**
+  Returns the lowest non-empty bucket, BUCKET_OVERFLOW if only the
+  overflow list holds elements, or -1 if the queue is empty. Every bucket
+  below min_bucket is empty, so the scan only ever moves forward between
+  offers of smaller keys.
+ */
+static int bucket_first(priqueue_t *q)
+{
+  if(q->size == 0)
+    return -1;
+  while(q->min_bucket < q->num_buckets && q->bucket_heads[q->min_bucket] == 0)
+    q->min_bucket++;
+  return q->min_bucket < q->num_buckets ? q->min_bucket : BUCKET_OVERFLOW;
+}
+
+/* Unlinks node from bucket b, where prev is the node before it or NULL. */
+static void bucket_unlink(priqueue_t *q, int b, Node* prev, Node* node)
+{
+  if(prev == 0)
+    *bucket_head(q, b) = node->next;
+  else
+    prev->next = node->next;
+  if(*bucket_tail(q, b) == node)
+    *bucket_tail(q, b) = prev;
+  node_free(q, node);
+  q->size--;
+}
+
+/* Finds the index'th node, storing its bucket and predecessor. */
+static Node* bucket_find(priqueue_t *q, int index, int *bucket, Node** prev)
+{
+  int b = bucket_first(q);
+  for(; b != -1; b = bucket_next(q, b))
+  {
+    Node* before = 0;
+    Node* node = *bucket_head(q, b);
+    for(; node != 0; before = node, node = node->next)
+    {
+      if(index-- == 0)
+      {
+        *bucket = b;
+        *prev = before;
+        return node;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+  Heap ordering: the comparer decides, and elements it considers equal are
+  kept in the order they were offered.
+ */
+static int heap_less(priqueue_t *q, const priqueue_entry_t *a, const priqueue_entry_t *b)
+{
+  int c = q->comp(a->pointer, b->pointer);
+  if(c != 0)
+    return c < 0;
+  return a->seq < b->seq;
+}
+
+/**
+  Stores entry in slot i, keeping the handle table of an indexed heap, or
+  the element's link in an intrusive one, in step with it.
+ */
+static void heap_place(priqueue_t *q, int i, priqueue_entry_t entry)
+{
+  q->heap[i] = entry;
+  if(q->positions)
+    q->positions[entry.handle] = i;
+  if(q->intrusive)
+  {
+    priqueue_link_t* link = LINK(q, entry.pointer);
+    link->owner = q;
+    link->index = i;
+  }
+}
+
+static void heap_reindex(priqueue_t *q)
+{
+  int i;
+  if(q->positions || q->intrusive)
+    for(i = 0; i < q->size; i++)
+      heap_place(q, i, q->heap[i]);
+}
+
+static int heap_sift_up(priqueue_t *q, int i)
+{
+  priqueue_entry_t entry = q->heap[i];
+  while(i > 0)
+  {
+    int parent = (i - 1) / PRIQUEUE_HEAP_ARITY;
+    if(!heap_less(q, &entry, &q->heap[parent]))
+      break;
+    heap_place(q, i, q->heap[parent]);
+    i = parent;
+  }
+  heap_place(q, i, entry);
+  return i;
+}
+
+static int heap_sift_down(priqueue_t *q, int i, int size)
+{
+  priqueue_entry_t entry = q->heap[i];
+  while(1)
+  {
+    int first = i * PRIQUEUE_HEAP_ARITY + 1;
+    if(first >= size)
+      break;
+    int last = first + PRIQUEUE_HEAP_ARITY;
+    if(last > size)
+      last = size;
+
+    int best = first;
+    int c;
+    for(c = first + 1; c < last; c++)
+    {
+      if(heap_less(q, &q->heap[c], &q->heap[best]))
+        best = c;
+    }
+    if(!heap_less(q, &q->heap[best], &entry))
+      break;
+    heap_place(q, i, q->heap[best]);
+    i = best;
+  }
+  heap_place(q, i, entry);
+  return i;
+}
+
+static void heap_build(priqueue_t *q)
+{
+  int i;
+  if(q->size < 2)
+    return;
+  for(i = (q->size - 2) / PRIQUEUE_HEAP_ARITY; i >= 0; i--)
+    heap_sift_down(q, i, q->size);
+}
+
+/**
+  Sorts the heap array in place. A sorted array is still a valid heap, so
+  this only has to be redone after the next offer or poll disturbs it, and
+  lets priqueue_at and priqueue_remove_at index the array directly.
+ */
+static void heap_order(priqueue_t *q)
+{
+  if(q->ordered)
+    return;
+
+  int i;
+  for(i = q->size - 1; i > 0; i--)
+  {
+    priqueue_entry_t temp = q->heap[0];
+    q->heap[0] = q->heap[i];
+    q->heap[i] = temp;
+    heap_sift_down(q, 0, i);
+  }
+  for(i = 0; i < q->size / 2; i++)
+  {
+    priqueue_entry_t temp = q->heap[i];
+    q->heap[i] = q->heap[q->size - 1 - i];
+    q->heap[q->size - 1 - i] = temp;
+  }
+  heap_reindex(q);
+  q->ordered = 1;
+}
+
+/**
+  Bottom-up merge sort of entries by heap order, using tmp as scratch
+  space of the same length.
+ */
+static void entries_sort(priqueue_t *q, priqueue_entry_t *entries, priqueue_entry_t *tmp, int n)
+{
+  priqueue_entry_t* from = entries;
+  priqueue_entry_t* to = tmp;
+  int width, i;
+
+  for(width = 1; width < n; width *= 2)
+  {
+    for(i = 0; i < n; i += 2 * width)
+    {
+      int mid = i + width < n ? i + width : n;
+      int end = i + 2 * width < n ? i + 2 * width : n;
+      int l = i, r = mid, k = i;
+      while(l < mid && r < end)
+        to[k++] = heap_less(q, &from[r], &from[l]) ? from[r++] : from[l++];
+      while(l < mid)
+        to[k++] = from[l++];
+      while(r < end)
+        to[k++] = from[r++];
+    }
+    priqueue_entry_t* temp = from;
+    from = to;
+    to = temp;
+  }
+
+  if(from != entries)
+    for(i = 0; i < n; i++)
+      entries[i] = from[i];
+}
+
+static void heap_reserve(priqueue_t *q, int count)
+{
+  if(count <= q->capacity)
+    return;
+
+  int capacity = q->capacity ? q->capacity : HEAP_INITIAL_CAPACITY;
+  while(capacity < count)
+    capacity *= 2;
+
+  priqueue_entry_t* heap = realloc(q->heap, capacity * sizeof(priqueue_entry_t));
+  if(heap == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    exit(2);
+  }
+  q->heap = heap;
+
+  if(q->backend == PRIQUEUE_INDEXED_HEAP)
+  {
+    int* positions = realloc(q->positions, capacity * sizeof(int));
+    int* free_handles = realloc(q->free_handles, capacity * sizeof(int));
+    if(positions == NULL || free_handles == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      exit(2);
+    }
+    q->positions = positions;
+    q->free_handles = free_handles;
+  }
+  q->capacity = capacity;
+}
+
+static int handle_acquire(priqueue_t *q)
+{
+  if(q->num_free > 0)
+    return q->free_handles[--q->num_free];
+  return q->handles++;
+}
+
+/* Forgets the handle and link of an entry leaving the heap. */
+static void entry_release(priqueue_t *q, priqueue_entry_t *entry)
+{
+  if(q->positions)
+  {
+    q->positions[entry->handle] = -1;
+    q->free_handles[q->num_free++] = entry->handle;
+  }
+  if(q->intrusive)
+    LINK(q, entry->pointer)->owner = 0;
+}
+
+static int handle_valid(priqueue_t *q, int handle)
+{
+  return q->backend == PRIQUEUE_INDEXED_HEAP && handle >= 0 && handle < q->handles
+      && q->positions[handle] >= 0;
+}
+
+/* Removes the entry in slot index of the heap in O(log n). */
+static void* heap_remove_slot(priqueue_t *q, int index)
+{
+  void* ptr = q->heap[index].pointer;
+  entry_release(q, &q->heap[index]);
+  q->size--;
+
+  if(index != q->size)
+  {
+    heap_place(q, index, q->heap[q->size]);
+    heap_sift_down(q, heap_sift_up(q, index), q->size);
+    q->ordered = q->size <= 1;
+  }
+  return ptr;
+}
+
+/**
+  Initializes the priqueue_t data structure.
+
+  Assumtions
+    - You may assume this function will only be called once per instance of priqueue_t
+    - You may assume this function will be the first function called using an instance of priqueue_t.
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  See also @ref comparer-page
+ */
+void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
+{
+  priqueue_init_backend(q, comparer, PRIQUEUE_LIST);
+}
+
+
+/**
+  Initializes the priqueue_t data structure with a specific storage backend.
+
+  PRIQUEUE_LIST keeps a sorted linked list (O(n) offer, O(1) poll).
+  PRIQUEUE_HEAP keeps an array-backed PRIQUEUE_HEAP_ARITY-ary heap
+  (O(log n) offer and poll, no allocation per element).
+  PRIQUEUE_INDEXED_HEAP is a heap whose priqueue_offer returns a stable
+  handle instead of an index, for use with priqueue_remove_handle and
+  priqueue_update_handle.
+  PRIQUEUE_BUCKET needs a key function; use priqueue_init_bucket. Passed
+  here, it falls back to PRIQUEUE_LIST.
+  All backends return elements the comparer considers equal in the order
+  they were offered.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  @param backend the storage backend to use
+ */
+void priqueue_init_backend(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend)
+{
+  q->backend = backend;
+  q->root = 0;
+  q->size = 0;
+  q->comp = comparer;
+
+  q->heap = 0;
+  q->capacity = 0;
+  q->ordered = 1;
+  q->seq = 0;
+
+  q->positions = 0;
+  q->free_handles = 0;
+  q->num_free = 0;
+  q->handles = 0;
+
+  q->free_nodes = 0;
+  q->fresh = 0;
+  q->fresh_left = 0;
+  q->slabs = 0;
+  q->pool_hits = 0;
+  q->pool_misses = 0;
+
+  q->cursor = 0;
+  q->cursor_index = 0;
+
+  q->intrusive = 0;
+  q->link_offset = 0;
+
+  q->key = 0;
+  q->bucket_heads = 0;
+  q->bucket_tails = 0;
+  q->num_buckets = 0;
+  q->min_bucket = 0;
+  q->overflow_head = 0;
+  q->overflow_tail = 0;
+
+  if(backend == PRIQUEUE_BUCKET)
+    q->backend = PRIQUEUE_LIST;
+}
+
+
+/**
+  Initializes the priqueue_t data structure as a bucket queue.
+
+  Elements are filed under the small non-negative integer key returns for
+  them, one bucket per key, and kept in comparer order within a bucket.
+  Offer and poll are O(1) amortized as long as keys stay within a bounded
+  range and key order agrees with the comparer: key(a) < key(b) must mean
+  a comes before b.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  @param key a function pointer returning the bucket of an element
+ */
+void priqueue_init_bucket(priqueue_t *q, int(*comparer)(const void *, const void *), int(*key)(const void *))
+{
+  priqueue_init_backend(q, comparer, PRIQUEUE_LIST);
+  q->backend = PRIQUEUE_BUCKET;
+  q->key = key;
+}
+
+
+/**
+  Gives the list backend a caller-owned block of memory to carve nodes out
+  of before it allocates slabs of its own. The queue never frees the arena,
+  which must outlive it. Any fresh nodes left from a previous arena or slab
+  are abandoned.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param arena the memory to carve nodes from
+  @param bytes the size of arena in bytes
+ */
+void priqueue_set_arena(priqueue_t *q, void *arena, size_t bytes)
+{
+  uintptr_t start = (uintptr_t)arena;
+  uintptr_t aligned = (start + _Alignof(Node) - 1) & ~(uintptr_t)(_Alignof(Node) - 1);
+
+  if(arena == NULL || aligned - start > bytes)
+  {
+    q->fresh_left = 0;
+    return;
+  }
+  q->fresh = (Node*)aligned;
+  q->fresh_left = (bytes - (aligned - start)) / sizeof(Node);
+}
+
+
+/**
+  Reports how list nodes were obtained: a hit reuses a node freed back to
+  the queue, a miss takes a node from the arena or a newly allocated slab.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param hits where to store the number of nodes reused, may be NULL
+  @param misses where to store the number of fresh nodes taken, may be NULL
+ */
+void priqueue_pool_stats(priqueue_t *q, unsigned long *hits, unsigned long *misses)
+{
+  if(hits)
+    *hits = q->pool_hits;
+  if(misses)
+    *misses = q->pool_misses;
+}
+
+
+/**
+  Makes q an intrusive queue: instead of allocating a node or keeping a
+  handle per element, it uses a priqueue_link_t embedded in each element,
+  link_offset bytes from its start. Queueing then allocates nothing, and
+  priqueue_remove goes straight to the element through its link, in O(1)
+  for the list backend and O(log n) for the heaps.
+
+  Call this before the first offer. An element can be in only one queue
+  per link at a time, and only once.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param link_offset offsetof() the priqueue_link_t member of the elements
+ */
+void priqueue_set_intrusive(priqueue_t *q, size_t link_offset)
+{
+  q->intrusive = 1;
+  q->link_offset = link_offset;
+}
+
+
+/**
+  Inserts the specified element into this priority queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @return The zero-based index where ptr is stored in the priority queue, where 0 indicates that ptr was stored at the front of the priority queue.
+  For the heap backend this is the slot in the heap array, which is 0 exactly when ptr is at the front.
+  @return For the indexed heap backend, a handle for ptr that stays valid until ptr leaves the queue.
+  @return For the bucket backend, 0 if ptr is at the front and 1 otherwise.
+ */
+int priqueue_offer(priqueue_t *q, void *ptr)
+{
+  if(IS_HEAP(q))
+  {
+    priqueue_entry_t entry;
+    entry.pointer = ptr;
+    entry.seq = q->seq++;
+    entry.handle = -1;
+
+    int tail = q->ordered && (q->size == 0 || !heap_less(q, &entry, &q->heap[q->size - 1]));
+
+    heap_reserve(q, q->size + 1);
+    if(q->backend == PRIQUEUE_INDEXED_HEAP)
+      entry.handle = handle_acquire(q);
+    heap_place(q, q->size, entry);
+    q->size++;
+    q->ordered = tail;
+
+    int index = heap_sift_up(q, q->size - 1);
+    return q->backend == PRIQUEUE_INDEXED_HEAP ? entry.handle : index;
+  }
+
+  if(q->backend == PRIQUEUE_BUCKET)
+  {
+    int b = bucket_of(q, ptr);
+    bucket_reserve(q, b);
+
+    Node* node = node_alloc(q, ptr);
+    node->next = 0;
+
+    Node* tail = *bucket_tail(q, b);
+    if(tail == 0)
+    {
+      *bucket_head(q, b) = node;
+      *bucket_tail(q, b) = node;
+    }
+    else if(q->comp(tail->pointer, ptr) <= 0)
+    {
+      tail->next = node;
+      *bucket_tail(q, b) = node;
+    }
+    else
+    {
+      /* The tail sorts after ptr, so this stops before the end. */
+      Node** link = bucket_head(q, b);
+      while(q->comp((*link)->pointer, ptr) <= 0)
+        link = &(*link)->next;
+      node->next = *link;
+      *link = node;
+    }
+
+    if(b < q->min_bucket)
+      q->min_bucket = b;
+    q->size++;
+    return bucket_first(q) == b && *bucket_head(q, b) == node ? 0 : 1;
+  }
+
+  Node* node = node_alloc(q, ptr);
+  node->next = 0;
+  if(q->size == 0)
+  {
+    q->size = 1;
+    q->root = node;
+    list_set_prev(q, node, 0);
+
+    return 0;
+  }
+  Node* temp = q->root;
+  Node* parent = 0;
+
+  int num = 0;
+  while(temp != 0 && q->comp(temp->pointer,ptr) <= 0)
+  {
+    parent = temp;
+    temp = temp->next;
+    num++;
+  }
+  if(num == 0)
+  {
+    q->size++;
+    node->next = q->root;
+    q->root = node;
+    list_set_prev(q, node, 0);
+    list_set_prev(q, node->next, node);
+    return 0;
+  }
+
+  parent->next = node;
+  node->next = temp;
+  list_set_prev(q, node, parent);
+  list_set_prev(q, temp, node);
+
+  q->size++;
+	return num;
+}
+
+
+/**
+  Inserts n elements at once, as if each had been passed to priqueue_offer
+  in array order.
+
+  The heap backend appends the elements and rebuilds the heap in O(n) when
+  the batch is larger than the queue. The list backend sorts the batch and
+  merges it into the list in one pass. The indexed heap does not report
+  handles for elements offered this way.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptrs the elements to insert
+  @param n the number of elements in ptrs
+  @return the number of elements inserted
+ */
+int priqueue_offer_bulk(priqueue_t *q, void **ptrs, int n)
+{
+  int i;
+  if(n <= 0)
+    return 0;
+
+  if(q->backend == PRIQUEUE_BUCKET)
+  {
+    for(i = 0; i < n; i++)
+      priqueue_offer(q, ptrs[i]);
+    return n;
+  }
+
+  if(IS_HEAP(q))
+  {
+    int old = q->size;
+    heap_reserve(q, q->size + n);
+    for(i = 0; i < n; i++)
+    {
+      priqueue_entry_t entry;
+      entry.pointer = ptrs[i];
+      entry.seq = q->seq++;
+      entry.handle = q->backend == PRIQUEUE_INDEXED_HEAP ? handle_acquire(q) : -1;
+      heap_place(q, old + i, entry);
+    }
+    q->size += n;
+
+    if(n > old)
+      heap_build(q);
+    else
+      for(i = old; i < q->size; i++)
+        heap_sift_up(q, i);
+    q->ordered = q->size <= 1;
+    return n;
+  }
+
+  priqueue_entry_t* sorted = malloc(2 * n * sizeof(priqueue_entry_t));
+  if(sorted == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    exit(2);
+  }
+  for(i = 0; i < n; i++)
+  {
+    sorted[i].pointer = ptrs[i];
+    sorted[i].seq = i;
+    sorted[i].handle = -1;
+  }
+  entries_sort(q, sorted, sorted + n, n);
+
+  Node* prev = 0;
+  Node** link = &q->root;
+  for(i = 0; i < n; i++)
+  {
+    while(*link != 0 && q->comp((*link)->pointer, sorted[i].pointer) <= 0)
+    {
+      prev = *link;
+      link = &prev->next;
+    }
+
+    Node* node = node_alloc(q, sorted[i].pointer);
+    node->next = *link;
+    *link = node;
+    list_set_prev(q, node, prev);
+    list_set_prev(q, node->next, node);
+    prev = node;
+    link = &node->next;
+  }
+  q->size += n;
+
+  free(sorted);
+  return n;
+}
+
+
+/**
+  Retrieves, but does not remove, the head of this queue, returning NULL if
+  this queue is empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return pointer to element at the head of the queue
+  @return NULL if the queue is empty
+ */
+void *priqueue_peek(priqueue_t *q)
+{
+  if(q->size == 0) {
+    return NULL;
+  } else if(IS_HEAP(q)) {
+    return q->heap[0].pointer;
+  } else if(q->backend == PRIQUEUE_BUCKET) {
+    return (*bucket_head(q, bucket_first(q)))->pointer;
+  } else {
+    return q->root->pointer;
+  }
+}
+
+
+/**
+  Retrieves and removes the head of this queue, or NULL if this queue
+  is empty.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the head of this queue
+  @return NULL if this queue is empty
+ */
+void *priqueue_poll(priqueue_t *q)
+{
+  if(q->size == 0) {
+    return NULL;
+  }
+  if(IS_HEAP(q))
+  {
+    void* ptr = q->heap[0].pointer;
+    entry_release(q, &q->heap[0]);
+    q->size--;
+    if(q->size > 0)
+    {
+      heap_place(q, 0, q->heap[q->size]);
+      heap_sift_down(q, 0, q->size);
+    }
+    q->ordered = q->size <= 1;
+    return ptr;
+  }
+  if(q->backend == PRIQUEUE_BUCKET)
+  {
+    int b = bucket_first(q);
+    Node* head = *bucket_head(q, b);
+    void* ptr = head->pointer;
+    bucket_unlink(q, b, 0, head);
+    return ptr;
+  }
+  void* ptr = q->root->pointer;
+  list_unlink(q, 0, q->root);
+  return ptr;
+}
+
+
+/**
+  Retrieves and removes up to k elements from the head of this queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param out the array to store the elements in, in queue order
+  @param k the maximum number of elements to remove
+  @return the number of elements removed
+ */
+int priqueue_poll_bulk(priqueue_t *q, void **out, int k)
+{
+  int i;
+  if(k > q->size)
+    k = q->size;
+  if(k <= 0)
+    return 0;
+
+  if(IS_HEAP(q) && (q->ordered || k == q->size))
+  {
+    /* The array is (or is made) sorted: take a prefix, the rest stays sorted. */
+    heap_order(q);
+    for(i = 0; i < k; i++)
+    {
+      out[i] = q->heap[i].pointer;
+      entry_release(q, &q->heap[i]);
+    }
+    q->size -= k;
+    for(i = 0; i < q->size; i++)
+      heap_place(q, i, q->heap[i + k]);
+    return k;
+  }
+
+  for(i = 0; i < k; i++)
+    out[i] = priqueue_poll(q);
+  return k;
+}
+
+
+/**
+  Returns the element at the specified position in this list, or NULL if
+  the queue does not contain an index'th element.
+
+  The list backend remembers the last position it reached, so reading the
+  queue front to back costs O(1) per call until the queue changes.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param index position of retrieved element
+  @return the index'th element in the queue
+  @return NULL if the queue does not contain the index'th element
+ */
+void *priqueue_at(priqueue_t *q, int index)
+{
+  if(index < 0 || index >= q->size) {
+    return 0;
+  } else if(IS_HEAP(q)) {
+    heap_order(q);
+    return q->heap[index].pointer;
+  } else if(q->backend == PRIQUEUE_BUCKET) {
+    int b;
+    Node* prev;
+    return bucket_find(q, index, &b, &prev)->pointer;
+  } else {
+    Node* temp = q->root;
+
+    int i = 1;
+    if(q->cursor != 0 && q->cursor_index <= index) {
+      temp = q->cursor;
+      i = q->cursor_index + 1;
+    }
+    while(i <= index) {
+      temp = temp->next;
+      i++;
+    }
+
+    q->cursor = temp;
+    q->cursor_index = index;
+    return temp->pointer;
+  }
+}
+
+
+/**
+  Starts an in-order walk over the queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param it the iterator to position before the head of q
+ */
+void priqueue_iter_begin(priqueue_t *q, priqueue_iter_t *it)
+{
+  if(IS_HEAP(q))
+    heap_order(q);
+  it->q = q;
+  it->node = q->root;
+  it->index = 0;
+  it->bucket = 0;
+
+  if(q->backend == PRIQUEUE_BUCKET)
+  {
+    it->bucket = bucket_first(q);
+    it->node = q->size > 0 ? *bucket_head(q, it->bucket) : 0;
+  }
+}
+
+
+/**
+  Returns the next element of an in-order walk, or NULL once every element
+  has been returned.
+
+  @param it an iterator set up by priqueue_iter_begin
+  @return the next element in the queue
+  @return NULL if the walk is over
+ */
+void *priqueue_iter_next(priqueue_iter_t *it)
+{
+  if(IS_HEAP(it->q))
+  {
+    if(it->index >= it->q->size)
+      return 0;
+    return it->q->heap[it->index++].pointer;
+  }
+
+  if(it->q->backend == PRIQUEUE_BUCKET)
+  {
+    while(it->node == 0)
+    {
+      if((it->bucket = bucket_next(it->q, it->bucket)) == -1)
+        return 0;
+      it->node = *bucket_head(it->q, it->bucket);
+    }
+  }
+
+  if(it->node == 0)
+    return 0;
+  void* ptr = it->node->pointer;
+  it->node = it->node->next;
+  it->index++;
+  return ptr;
+}
+
+
+/**
+  Copies the elements of the queue, in order, into an array in O(n).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param out the array to fill
+  @param max the number of elements out can hold
+  @return the number of elements copied
+ */
+int priqueue_snapshot(priqueue_t *q, void **out, int max)
+{
+  priqueue_iter_t it;
+  void* ptr;
+  int count = 0;
+
+  priqueue_iter_begin(q, &it);
+  while(count < max && (ptr = priqueue_iter_next(&it)) != 0)
+    out[count++] = ptr;
+  return count;
+}
+
+
+/**
+  Removes all instances of ptr from the queue.
+
+  This function should not use the comparer function,
+  but check if the data contained in each element of the queue is equal (==) to ptr.
+  An intrusive queue looks ptr up through its link instead of searching.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr address of element to be removed
+  @return the number of entries removed
+ */
+int priqueue_remove(priqueue_t *q, void *ptr)
+{
+  int num = 0;
+
+  if(q->intrusive && q->backend != PRIQUEUE_BUCKET)
+  {
+    priqueue_link_t* link = LINK(q, ptr);
+    if(link->owner != q)
+      return 0;
+    if(IS_HEAP(q))
+      heap_remove_slot(q, link->index);
+    else
+      list_unlink(q, link->prev, &link->node);
+    return 1;
+  }
+
+  if(IS_HEAP(q))
+  {
+    int i, kept = 0;
+    for(i = 0; i < q->size; i++)
+    {
+      if(q->heap[i].pointer == ptr)
+      {
+        entry_release(q, &q->heap[i]);
+        num++;
+      }
+      else
+      {
+        q->heap[kept++] = q->heap[i];
+      }
+    }
+    q->size = kept;
+    if(num > 0 && !q->ordered)
+      heap_build(q);
+    heap_reindex(q);
+    return num;
+  }
+
+  if(q->backend == PRIQUEUE_BUCKET)
+  {
+    int b;
+    for(b = bucket_first(q); b != -1; b = bucket_next(q, b))
+    {
+      Node* prev = 0;
+      Node* current = *bucket_head(q, b);
+      while(current != 0)
+      {
+        Node* next = current->next;
+        if(current->pointer == ptr)
+        {
+          bucket_unlink(q, b, prev, current);
+          num++;
+        }
+        else
+        {
+          prev = current;
+        }
+        current = next;
+      }
+    }
+    return num;
+  }
+
+  Node* prev = 0;
+  Node* current = q->root;
+  while(current != 0)
+  {
+    Node* next = current->next;
+    if(current->pointer == ptr)
+    {
+      list_unlink(q, prev, current);
+      num++;
+    }
+    else
+    {
+      prev = current;
+    }
+    current = next;
+  }
+  return num;
+}
+
+
+/**
+  Removes the specified index from the queue, moving later elements up
+  a spot in the queue to fill the gap.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param index position of element to be removed
+  @return the element removed from the queue
+  @return NULL if the specified index does not exist
+ */
+void *priqueue_remove_at(priqueue_t *q, int index)
+{
+  if(index < 0 || index > q->size - 1)
+    return 0;
+
+  if(IS_HEAP(q))
+  {
+    heap_order(q);
+    void* ptr = q->heap[index].pointer;
+    entry_release(q, &q->heap[index]);
+    q->size--;
+    int i;
+    for(i = index; i < q->size; i++)
+      heap_place(q, i, q->heap[i + 1]);
+    return ptr;
+  }
+
+  if(q->backend == PRIQUEUE_BUCKET)
+  {
+    int b;
+    Node* prev;
+    Node* node = bucket_find(q, index, &b, &prev);
+    void* ptr = node->pointer;
+    bucket_unlink(q, b, prev, node);
+    return ptr;
+  }
+
+  Node* prev = 0;
+  Node* temp = q->root;
+  while(index > 0)
+  {
+    prev = temp;
+    temp = temp->next;
+    index--;
+  }
+
+  void* ptr = temp->pointer;
+  list_unlink(q, prev, temp);
+  return ptr;
+}
+
+
+/**
+  Removes the element a handle refers to in O(log n).
+
+  @param q a pointer to an instance of the priqueue_t data structure, initialized with PRIQUEUE_INDEXED_HEAP
+  @param handle the handle priqueue_offer returned for the element
+  @return the element removed from the queue
+  @return NULL if handle does not refer to an element in the queue
+ */
+void *priqueue_remove_handle(priqueue_t *q, int handle)
+{
+  if(!handle_valid(q, handle))
+    return 0;
+
+  return heap_remove_slot(q, q->positions[handle]);
+}
+
+
+/**
+  Restores the position of an element after the caller changed the fields
+  the comparer looks at, in O(log n). The element keeps its place among
+  equal elements.
+
+  @param q a pointer to an instance of the priqueue_t data structure, initialized with PRIQUEUE_INDEXED_HEAP
+  @param handle the handle priqueue_offer returned for the element
+  @return the slot in the heap array now holding the element, 0 meaning the front of the queue
+  @return -1 if handle does not refer to an element in the queue
+ */
+int priqueue_update_handle(priqueue_t *q, int handle)
+{
+  if(!handle_valid(q, handle))
+    return -1;
+
+  q->ordered = q->size <= 1;
+  return heap_sift_down(q, heap_sift_up(q, q->positions[handle]), q->size);
+}
+
+
+/**
+  Returns the number of elements in the queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the number of elements in the queue
+ */
+int priqueue_size(priqueue_t *q)
+{
+  return q->size;
+}
+
+
+/**
+  Destroys and frees all the memory associated with q.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+ */
+void priqueue_destroy(priqueue_t *q)
+{
+  if(q->intrusive)
+  {
+    /* Release the links of whatever is still queued. */
+    while(q->size > 0)
+      priqueue_poll(q);
+  }
+
+  while(q->slabs != 0)
+  {
+    priqueue_slab_t* slab = q->slabs;
+    q->slabs = slab->next;
+    free(slab);
+  }
+  q->root = 0;
+  q->free_nodes = 0;
+  q->fresh_left = 0;
+  q->cursor = 0;
+
+  free(q->heap);
+  free(q->positions);
+  free(q->free_handles);
+  q->heap = 0;
+  q->positions = 0;
+  q->free_handles = 0;
+  q->num_free = 0;
+  q->handles = 0;
+  q->capacity = 0;
+  q->size = 0;
+
+  free(q->bucket_heads);
+  free(q->bucket_tails);
+  q->bucket_heads = 0;
+  q->bucket_tails = 0;
+  q->num_buckets = 0;
+  q->min_bucket = 0;
+  q->overflow_head = 0;
+  q->overflow_tail = 0;
+}
@@ -1,37 +1,151 @@
-/** @file libpriqueue.h
- */
-
-#ifndef LIBPRIQUEUE_H_
-#define LIBPRIQUEUE_H_
-
-struct Node;
-/**
-  Priqueue Data Structure
-*/
-
-typedef struct Node
-{
-  struct Node* next;
-  void* pointer;
-} Node;
-typedef struct _priqueue_t
-{
-  Node* root;
-  int size;
-  int(*comp)(const void *, const void *);
-} priqueue_t;
-
-
-void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
-
-int    priqueue_offer    (priqueue_t *q, void *ptr);
-void * priqueue_peek     (priqueue_t *q);
-void * priqueue_poll     (priqueue_t *q);
-void * priqueue_at       (priqueue_t *q, int index);
-int    priqueue_remove   (priqueue_t *q, void *ptr);
-void * priqueue_remove_at(priqueue_t *q, int index);
-int    priqueue_size     (priqueue_t *q);
-
-void   priqueue_destroy  (priqueue_t *q);
-
-#endif /* LIBPQUEUE_H_ */
+/** @file libpriqueue.h
+ */
+
+#ifndef LIBPRIQUEUE_H_
+#define LIBPRIQUEUE_H_
+
+#include <stddef.h>
+
+/**
+  Number of children per node used by the heap backend.
+*/
+#ifndef PRIQUEUE_HEAP_ARITY
+#define PRIQUEUE_HEAP_ARITY 4
+#endif
+
+/**
+  Number of list nodes the list backend allocates at a time.
+*/
+#ifndef PRIQUEUE_SLAB_NODES
+#define PRIQUEUE_SLAB_NODES 64
+#endif
+
+/**
+  Largest key + 1 the bucket backend keeps a separate bucket for. Larger
+  keys share one overflow list after every bucket, which takes no array
+  space, so a single huge key costs no more than a small one.
+*/
+#ifndef PRIQUEUE_BUCKET_LIMIT
+#define PRIQUEUE_BUCKET_LIMIT (1 << 20)
+#endif
+
+/**
+  Storage strategies that can back a priqueue_t
+*/
+typedef enum {PRIQUEUE_LIST = 0, PRIQUEUE_HEAP, PRIQUEUE_INDEXED_HEAP, PRIQUEUE_BUCKET} priqueue_backend_t;
+
+struct Node;
+/**
+  Priqueue Data Structure
+*/
+
+typedef struct Node
+{
+  struct Node* next;
+  void* pointer;
+} Node;
+
+struct _priqueue_slab_t;
+struct _priqueue_t;
+
+/**
+  Link embedded in the elements of an intrusive priqueue_t. It holds the
+  element's list node and heap slot, so the queue allocates nothing per
+  element and can find an element without searching for it. Zero it before
+  the element is first used.
+*/
+typedef struct _priqueue_link_t
+{
+  Node node;
+  Node* prev;
+  struct _priqueue_t* owner;
+  int index;
+} priqueue_link_t;
+
+typedef struct _priqueue_entry_t
+{
+  void* pointer;
+  unsigned long seq;
+  int handle;
+} priqueue_entry_t;
+
+typedef struct _priqueue_t
+{
+  priqueue_backend_t backend;
+  Node* root;
+  int size;
+  int(*comp)(const void *, const void *);
+
+  priqueue_entry_t* heap;
+  int capacity;
+  int ordered;
+  unsigned long seq;
+
+  int* positions;
+  int* free_handles;
+  int num_free;
+  int handles;
+
+  Node* free_nodes;
+  Node* fresh;
+  int fresh_left;
+  struct _priqueue_slab_t* slabs;
+  unsigned long pool_hits;
+  unsigned long pool_misses;
+
+  Node* cursor;
+  int cursor_index;
+
+  int intrusive;
+  size_t link_offset;
+
+  int(*key)(const void *);
+  Node** bucket_heads;
+  Node** bucket_tails;
+  int num_buckets;
+  int min_bucket;
+  Node* overflow_head;
+  Node* overflow_tail;
+} priqueue_t;
+
+/**
+  Position of an in-order walk over a priqueue_t. Any change to the queue
+  invalidates it.
+*/
+typedef struct _priqueue_iter_t
+{
+  priqueue_t* q;
+  Node* node;
+  int index;
+  int bucket;
+} priqueue_iter_t;
+
+
+void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
+void   priqueue_init_backend(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend);
+void   priqueue_init_bucket(priqueue_t *q, int(*comparer)(const void *, const void *), int(*key)(const void *));
+
+int    priqueue_offer    (priqueue_t *q, void *ptr);
+int    priqueue_offer_bulk(priqueue_t *q, void **ptrs, int n);
+void * priqueue_peek     (priqueue_t *q);
+void * priqueue_poll     (priqueue_t *q);
+int    priqueue_poll_bulk(priqueue_t *q, void **out, int k);
+void * priqueue_at       (priqueue_t *q, int index);
+int    priqueue_remove   (priqueue_t *q, void *ptr);
+void * priqueue_remove_at(priqueue_t *q, int index);
+int    priqueue_size     (priqueue_t *q);
+
+void   priqueue_iter_begin(priqueue_t *q, priqueue_iter_t *it);
+void * priqueue_iter_next (priqueue_iter_t *it);
+int    priqueue_snapshot  (priqueue_t *q, void **out, int max);
+
+void   priqueue_set_arena(priqueue_t *q, void *arena, size_t bytes);
+void   priqueue_pool_stats(priqueue_t *q, unsigned long *hits, unsigned long *misses);
+void   priqueue_set_intrusive(priqueue_t *q, size_t link_offset);
+
+void * priqueue_remove_handle(priqueue_t *q, int handle);
+int    priqueue_update_handle(priqueue_t *q, int handle);
+
+void   priqueue_destroy  (priqueue_t *q);
+
+#endif /* LIBPQUEUE_H_ */
@@ -0,0 +1,193 @@
+/** @file priqueue_typed.h
+
+  Type-specialized priority queues.
+
+  PRIQUEUE_DEFINE(name, type, less, moved) defines name##_t, an array-backed
+  PRIQUEUE_HEAP_ARITY-ary heap storing elements of `type` by value, along
+  with static inline functions name##_init, name##_offer, name##_peek,
+  name##_poll, name##_remove_at, name##_update, name##_order, name##_size
+  and name##_destroy.
+
+  less(a, b) is an expression on two `const type *` that is true when a
+  must leave the queue before b. It is expanded in place, so comparisons
+  compile down to plain field reads instead of calls through a comparer.
+  Like priqueue_t, it must be a strict order; include an insertion counter
+  in `type` if equal keys have to come out first-in first-out.
+
+  moved(item, index) runs whenever an element lands in a new slot of the
+  array, so callers that need to remove or reprioritize an element can
+  track its index. Pass PRIQUEUE_NO_MOVE when nothing needs tracking.
+ */
+
+#ifndef PRIQUEUE_TYPED_H_
+#define PRIQUEUE_TYPED_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+#define PRIQUEUE_NO_MOVE(item, index) ((void)0)
+
+#define PRIQUEUE_DEFINE(name, type, less, moved)                              \
+                                                                              \
+typedef struct _##name##_t                                                    \
+{                                                                             \
+  type* items;                                                                \
+  int size;                                                                   \
+  int capacity;                                                               \
+  int ordered;                                                                \
+} name##_t;                                                                   \
+                                                                              \
+static inline void name##_place(name##_t *q, int i, type item)                \
+{                                                                             \
+  q->items[i] = item;                                                         \
+  moved(&q->items[i], i);                                                     \
+}                                                                             \
+                                                                              \
+static inline int name##_sift_up(name##_t *q, int i)                          \
+{                                                                             \
+  type item = q->items[i];                                                    \
+  while(i > 0)                                                                \
+  {                                                                           \
+    int parent = (i - 1) / PRIQUEUE_HEAP_ARITY;                               \
+    if(!(less(&item, &q->items[parent])))                                     \
+      break;                                                                  \
+    name##_place(q, i, q->items[parent]);                                     \
+    i = parent;                                                               \
+  }                                                                           \
+  name##_place(q, i, item);                                                   \
+  return i;                                                                   \
+}                                                                             \
+                                                                              \
+static inline int name##_sift_down(name##_t *q, int i, int size)              \
+{                                                                             \
+  type item = q->items[i];                                                    \
+  while(1)                                                                    \
+  {                                                                           \
+    int first = i * PRIQUEUE_HEAP_ARITY + 1;                                  \
+    if(first >= size)                                                         \
+      break;                                                                  \
+    int last = first + PRIQUEUE_HEAP_ARITY;                                   \
+    if(last > size)                                                           \
+      last = size;                                                            \
+                                                                              \
+    int best = first;                                                         \
+    int c;                                                                    \
+    for(c = first + 1; c < last; c++)                                         \
+    {                                                                         \
+      if(less(&q->items[c], &q->items[best]))                                 \
+        best = c;                                                             \
+    }                                                                         \
+    if(!(less(&q->items[best], &item)))                                       \
+      break;                                                                  \
+    name##_place(q, i, q->items[best]);                                       \
+    i = best;                                                                 \
+  }                                                                           \
+  name##_place(q, i, item);                                                   \
+  return i;                                                                   \
+}                                                                             \
+                                                                              \
+static inline void name##_init(name##_t *q)                                   \
+{                                                                             \
+  q->items = 0;                                                               \
+  q->size = 0;                                                                \
+  q->capacity = 0;                                                            \
+  q->ordered = 1;                                                             \
+}                                                                             \
+                                                                              \
+static inline void name##_destroy(name##_t *q)                                \
+{                                                                             \
+  free(q->items);                                                             \
+  name##_init(q);                                                             \
+}                                                                             \
+                                                                              \
+static inline int name##_size(name##_t *q)                                    \
+{                                                                             \
+  return q->size;                                                             \
+}                                                                             \
+                                                                              \
+/* Returns the head of the queue, or NULL if it is empty. */                  \
+static inline type* name##_peek(name##_t *q)                                  \
+{                                                                             \
+  return q->size > 0 ? &q->items[0] : 0;                                      \
+}                                                                             \
+                                                                              \
+/* Returns the slot item landed in; 0 means the front of the queue. */       \
+static inline int name##_offer(name##_t *q, type item)                        \
+{                                                                             \
+  if(q->size == q->capacity)                                                  \
+  {                                                                           \
+    int capacity = q->capacity ? q->capacity * 2 : 16;                        \
+    type* items = realloc(q->items, capacity * sizeof(type));                 \
+    if(items == NULL)                                                         \
+    {                                                                         \
+      fprintf(stderr, "Out of memory.\n");                                    \
+      exit(2);                                                                \
+    }                                                                         \
+    q->items = items;                                                         \
+    q->capacity = capacity;                                                   \
+  }                                                                           \
+                                                                              \
+  q->ordered = q->ordered                                                     \
+      && (q->size == 0 || !(less(&item, &q->items[q->size - 1])));            \
+  name##_place(q, q->size, item);                                             \
+  q->size++;                                                                  \
+  return name##_sift_up(q, q->size - 1);                                      \
+}                                                                             \
+                                                                              \
+/* Removes the element in slot i, storing it in out if out is not NULL. */    \
+static inline void name##_remove_at(name##_t *q, int i, type *out)            \
+{                                                                             \
+  if(out)                                                                     \
+    *out = q->items[i];                                                       \
+  q->size--;                                                                  \
+  if(i != q->size)                                                            \
+  {                                                                           \
+    name##_place(q, i, q->items[q->size]);                                    \
+    name##_sift_down(q, name##_sift_up(q, i), q->size);                       \
+    q->ordered = q->size <= 1;                                                \
+  }                                                                           \
+}                                                                             \
+                                                                              \
+/* Removes the head into out; returns 0 if the queue was empty. */            \
+static inline int name##_poll(name##_t *q, type *out)                         \
+{                                                                             \
+  if(q->size == 0)                                                            \
+    return 0;                                                                 \
+  name##_remove_at(q, 0, out);                                                \
+  return 1;                                                                   \
+}                                                                             \
+                                                                              \
+/* Restores the order after the key of the element in slot i changed. */     \
+static inline int name##_update(name##_t *q, int i)                           \
+{                                                                             \
+  q->ordered = q->size <= 1;                                                  \
+  return name##_sift_down(q, name##_sift_up(q, i), q->size);                  \
+}                                                                             \
+                                                                              \
+/* Sorts items[0..size) in place; a sorted array is still a valid heap. */    \
+static inline void name##_order(name##_t *q)                                  \
+{                                                                             \
+  int i;                                                                      \
+  if(q->ordered)                                                              \
+    return;                                                                   \
+  for(i = q->size - 1; i > 0; i--)                                            \
+  {                                                                           \
+    type temp = q->items[0];                                                  \
+    q->items[0] = q->items[i];                                                \
+    q->items[i] = temp;                                                       \
+    name##_sift_down(q, 0, i);                                                \
+  }                                                                           \
+  for(i = 0; i < q->size / 2; i++)                                            \
+  {                                                                           \
+    type temp = q->items[i];                                                  \
+    q->items[i] = q->items[q->size - 1 - i];                                  \
+    q->items[q->size - 1 - i] = temp;                                         \
+  }                                                                           \
+  for(i = 0; i < q->size; i++)                                                \
+    moved(&q->items[i], i);                                                   \
+  q->ordered = 1;                                                             \
+}
+
+#endif /* PRIQUEUE_TYPED_H_ */
@@ -1,408 +1,1657 @@
-/** @file libscheduler.c
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include "libscheduler.h"
-#include "../libpriqueue/libpriqueue.h"
-
-
-/**
-  Stores information making up a job to be scheduled including any statistics.
-
-  You may need to define some global variables or a struct to store your job queue elements.
-*/
-priqueue_t queue;
-int preemptive;
-int numCores;
-int(*comp)(const void *, const void *);
-float waitingTime, turnaroundTime, responseTime;
-int numJobs;
-int currentTime;
-
-typedef struct _job_t
-{
-  int number;
-  int arrival_time;
-  int start_time;
-  int running_time;
-  int remaining_time;
-  int priority;
-} job_t;
-
-job_t** coreInUse;
-
-int fcfs(const void *a, const void *b)
-{
-  job_t* joba = (job_t*)a;
-  job_t* jobb = (job_t*)b;
-  if(joba->number == jobb->number)
-    return 0;
-  return joba->arrival_time - jobb->arrival_time;
-}
-
-int sjf(const void *a, const void *b)
-{
-  job_t* joba = (job_t*)a;
-  job_t* jobb = (job_t*)b;
-  if(joba->number == jobb->number)
-    return 0;
-  int diff = joba->remaining_time - jobb->remaining_time;
-  if(diff == 0)
-    return joba->arrival_time - jobb->arrival_time;
-  else
-    return diff;
-}
-
-int pri(const void *a, const void *b)
-{
-  job_t* joba = (job_t*)a;
-  job_t* jobb = (job_t*)b;
-  if(joba->number == jobb->number)
-    return 0;
-  int diff = joba->priority - jobb->priority;
-  if(diff == 0)
-    return joba->arrival_time - jobb->arrival_time;
-  else
-    return diff;
-}
-
-int rr(const void *a, const void *b)
-{
-  job_t* joba = (job_t*)a;
-  job_t* jobb = (job_t*)b;
-  if(joba->number == jobb->number)
-    return 0;
-  return -1;
-}
-
-/**
-  Initalizes the scheduler.
-
-  Assumptions:
-    - You may assume this will be the first scheduler function called.
-    - You may assume this function will be called once once.
-    - You may assume that cores is a positive, non-zero number.
-    - You may assume that scheme is a valid scheduling scheme.
-
-  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
-  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
-*/
-void scheduler_start_up(int cores, scheme_t scheme)
-{
-  waitingTime = 0.0;
-  turnaroundTime = 0.0;
-  responseTime = 0.0;
-  numJobs = 0;
-  currentTime = 0;
-
-  numCores = cores;
-
-  coreInUse = malloc(sizeof(job_t) * cores);
-
-  int i = 0;
-  while(i < cores)
-  {
-    coreInUse[i] = 0;
-    i++;
-  }
-
-  switch(scheme)
-  {
-    case FCFS: comp = fcfs; preemptive = 0; break;
-    case SJF:  comp = sjf;  preemptive = 0; break;
-    case PSJF: comp = sjf;  preemptive = 1; break;
-    case PRI:  comp = pri;  preemptive = 0; break;
-    case PPRI: comp = pri;  preemptive = 1; break;
-    case RR:   comp = rr;   preemptive = 0; break;
-  }
-
-  priqueue_init(&queue,comp);
-}
-
-
-/**
-  Called when a new job arrives.
-
-  If multiple cores are idle, the job should be assigned to the core with the
-  lowest id.
-  If the job arriving should be scheduled to run during the next
-  time cycle, return the zero-based index of the core the job should be
-  scheduled on. If another job is already running on the core specified,
-  this will preempt the currently running job.
-  Assumptions:
-    - You may assume that every job wil have a unique arrival time.
-
-  @param job_number a globally unique identification number of the job arriving.
-  @param time the current time of the simulator.
-  @param running_time the total number of time units this job will run before it will be finished.
-  @param priority the priority of the job. (The lower the value, the higher the priority.)
-  @return index of core job should be scheduled on
-  @return -1 if no scheduling changes should be made.
-
- */
-int scheduler_new_job(int job_number, int time, int running_time, int priority)
-{
-  deincrement_Remaining_Times(time);
-
-  job_t* job = malloc(sizeof(job_t));
-  job->number = job_number;
-  job->arrival_time = time;
-  job->start_time = -1;
-  job->running_time = running_time;
-  job->remaining_time = running_time;
-  job->priority = priority;
-
-  int core = are_Any_Cores_Idle();
-  if(core != -1)
-  {
-    job->start_time = time;
-    // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
-    //         job->number, job->arrival_time, job->start_time);
-    coreInUse[core] = job;
-    return core;
-  }
-
-  if(preemptive)
-  {
-    core = get_Least_Preferential_Job(job);
-    if(core > -1)
-    {
-      job_t* temp = coreInUse[core];
-      if(time == temp->start_time)
-      {
-        temp->start_time = -1;
-        // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
-        //         temp->number, temp->arrival_time, temp->start_time);
-      }
-      job->start_time = time;
-      // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
-      //         job->number, job->arrival_time, job->start_time);
-      coreInUse[core] = job;
-      priqueue_offer(&queue,temp);
-      return core;
-    }
-  }
-
-  priqueue_offer(&queue,(void*)job);
-
-  return -1;
-}
-
-
-/**
-  Called when a job has completed execution.
-
-  The core_id, job_number and time parameters are provided for convenience. You may be able to calculate the values with your own data structure.
-  If any job should be scheduled to run on the core free'd up by the
-  finished job, return the job_number of the job that should be scheduled to
-  run on core core_id.
-
-  @param core_id the zero-based index of the core where the job was located.
-  @param job_number a globally unique identification number of the job.
-  @param time the current time of the simulator.
-  @return job_number of the job that should be scheduled to run on core core_id
-  @return -1 if core should remain idle.
- */
-int scheduler_job_finished(int core_id, int job_number, int time)
-{
-  deincrement_Remaining_Times(time);
-
-  job_t* finJob = coreInUse[core_id];
-  numJobs++;
-  waitingTime += (time - finJob->arrival_time - finJob->running_time);
-  turnaroundTime += (time - finJob->arrival_time);
-  responseTime+=(finJob->start_time - finJob->arrival_time);
-  // printf("---Added %d to response time.\n",finJob->start_time - finJob->arrival_time);
-
-
-  free(coreInUse[core_id]);
-  coreInUse[core_id] = 0;
-
-  if(priqueue_size(&queue) > 0)
-  {
-    job_t* job = (job_t*)priqueue_poll(&queue);
-    if(job->start_time == -1)
-    {
-      job->start_time = time;
-      // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
-      //         job->number, job->arrival_time, job->start_time);
-    }
-    coreInUse[core_id] = job;
-    return job->number;
-  }
-
-	return -1;
-}
-
-
-/**
-  When the scheme is set to RR, called when the quantum timer has expired
-  on a core.
-
-  If any job should be scheduled to run on the core free'd up by
-  the quantum expiration, return the job_number of the job that should be
-  scheduled to run on core core_id.
-
-  @param core_id the zero-based index of the core where the quantum has expired.
-  @param time the current time of the simulator.
-  @return job_number of the job that should be scheduled on core cord_id
-  @return -1 if core should remain idle
- */
-int scheduler_quantum_expired(int core_id, int time)
-{
-  deincrement_Remaining_Times(time);
-
-  job_t* job = coreInUse[core_id];
-
-  if(priqueue_size(&queue) > 0)
-  {
-    priqueue_offer(&queue,job);
-    job = priqueue_poll(&queue);
-    if(job->start_time == -1)
-      job->start_time = time;
-    coreInUse[core_id] = job;
-  }
-  return job->number;
-}
-
-
-/**
-  Returns the average waiting time of all jobs scheduled by your scheduler.
-
-  Assumptions:
-    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
-  @return the average waiting time of all jobs scheduled.
- */
-float scheduler_average_waiting_time()
-{
-  if(numJobs > 0)
-  {
-    return waitingTime/numJobs;
-  }
-	return 0.0;
-}
-
-
-/**
-  Returns the average turnaround time of all jobs scheduled by your scheduler.
-
-  Assumptions:
-    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
-  @return the average turnaround time of all jobs scheduled.
- */
-float scheduler_average_turnaround_time()
-{
-  if(numJobs > 0)
-  {
-    return turnaroundTime/numJobs;
-  }
-	return 0.0;
-}
-
-
-/**
-  Returns the average response time of all jobs scheduled by your scheduler.
-
-  Assumptions:
-    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
-  @return the average response time of all jobs scheduled.
- */
-float scheduler_average_response_time()
-{
-  if(!preemptive && comp != rr)
-    return waitingTime/numJobs;
-  else
-    return responseTime/numJobs;
-}
-
-
-/**
-  Free any memory associated with your scheduler.
-
-  Assumptions:
-    - This function will be the last function called in your library.
-*/
-void scheduler_clean_up()
-{
-  priqueue_destroy(&queue);
-}
-
-
-/**
-  This function may print out any debugging information you choose. This
-  function will be called by the simulator after every call the simulator
-  makes to your scheduler.
-  In our provided output, we have implemented this function to list the jobs in the order they are to be scheduled.
-  Furthermore, we have also listed the current state of the job (either running on a given core or idle).
-  For example, if we have a non-preemptive algorithm and job(id=4) has began running, job(id=2) arrives with a higher priority,
-  and job(id=1) arrives with a lower priority, the output in our sample output will be:
-
-    2(-1) 4(0) 1(-1)
-
-  This function is not required and will not be graded. You may leave it
-  blank if you do not find it useful.
- */
-void scheduler_show_queue()
-{
-  int x = 0;
-  int size = priqueue_size(&queue);
-  if(size == 0)
-  {
-    printf("Queue is empty");
-    return;
-  }
-  while(x < size)
-  {
-    job_t* job = (job_t*)priqueue_at(&queue, x);
-    printf("Index: %d Job Number:%d Arrival Time: %d Remaining Time: %d Priority: %d\n",
-           x, job->number, job->arrival_time, job->remaining_time, job->priority);
-    x++;
-  }
-}
-
-int are_Any_Cores_Idle()
-{
-  int i = 0;
-  while(i < numCores)
-  {
-    if(coreInUse[i] == 0)
-      return i;
-    i++;
-  }
-  return -1;
-}
-
-void deincrement_Remaining_Times(int time)
-{
-  int timeDifference = (time - currentTime);
-
-  int i = 0;
-  while(i < numCores)
-  {
-    if(coreInUse[i] != 0)
-      coreInUse[i]->remaining_time -= timeDifference;
-    i++;
-  }
-  currentTime = time;
-}
-
-int get_Least_Preferential_Job(void* job)
-{
-  job_t* currentJob = (job_t*)job;
-  int core = -1;
-
-  int i = 0;
-  while(i < numCores)
-  {
-    if(comp(currentJob,coreInUse[i]) < 0)
-    {
-      core = i;
-      currentJob = coreInUse[i];
-    }
-    i++;
-  }
-  return core;
-}
+/** @file libscheduler.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "libscheduler.h"
+#include "../libpriqueue/priqueue_typed.h"
+
+#define UNUSED(x) (void)(x)
+
+
+/**
+  Stores information making up a job to be scheduled including any statistics.
+
+  You may need to define some global variables or a struct to store your job queue elements.
+*/
+typedef struct _job_t
+{
+  int number;
+  int arrival_time;
+  int start_time;
+  int running_time;
+  int remaining_time;
+  int since;
+  int last_core;
+  int level;
+  int slice;
+  int boosted;
+  uint64_t vruntime;
+  int weight;
+  int deadline;
+  int period;
+  int priority;
+  priqueue_link_t link;
+} job_t;
+
+/**
+  A queued job with its sort key copied next to it, so ordering the queue
+  never has to follow the job pointer. Jobs that tie on key and tie come
+  out in the order they were queued.
+*/
+typedef struct _job_key_t
+{
+  int key;
+  int tie;
+  unsigned int seq;
+  job_t* job;
+} job_key_t;
+
+#define JOB_KEY_LESS(a, b) \
+  ((a)->key != (b)->key ? (a)->key < (b)->key : \
+   (a)->tie != (b)->tie ? (a)->tie < (b)->tie : (a)->seq < (b)->seq)
+
+PRIQUEUE_DEFINE(jobq, job_key_t, JOB_KEY_LESS, PRIQUEUE_NO_MOVE)
+
+struct _scheduler_t;
+
+/**
+  A job running on a core, in the heap that keeps the least preferential
+  running job on top for preemptive schemes.
+*/
+typedef struct _running_t
+{
+  job_t* job;
+  int core;
+  struct _scheduler_t* s;
+} running_t;
+
+static int running_less(const running_t *a, const running_t *b);
+static void running_moved(running_t *item, int index);
+
+PRIQUEUE_DEFINE(runq, running_t, running_less, running_moved)
+
+/**
+  A per-core run queue, in the heaps that find the shortest and the
+  longest of them.
+*/
+typedef struct _load_t
+{
+  int queue;
+  struct _scheduler_t* s;
+} load_t;
+
+static int shortest_less(const load_t *a, const load_t *b);
+static int longest_less(const load_t *a, const load_t *b);
+static void shortest_moved(load_t *item, int index);
+static void longest_moved(load_t *item, int index);
+
+PRIQUEUE_DEFINE(shortq, load_t, shortest_less, shortest_moved)
+PRIQUEUE_DEFINE(longq, load_t, longest_less, longest_moved)
+
+/**
+  Number of values a histogram tells apart exactly, and the number of
+  buckets each further power of two is split into
+*/
+#define HISTOGRAM_SUB_BUCKETS 128
+#define HISTOGRAM_HALF (HISTOGRAM_SUB_BUCKETS / 2)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_HALF * 25 + HISTOGRAM_HALF)
+
+/**
+  A log-bucketed histogram in the style of HdrHistogram. Values below
+  HISTOGRAM_SUB_BUCKETS get a bucket each; above that, each power of two
+  is split into HISTOGRAM_HALF buckets, so a bucket is never wider than
+  1/64 of the values in it. Its size is fixed, however many values are
+  recorded.
+*/
+typedef struct _histogram_t
+{
+  uint64_t counts[HISTOGRAM_BUCKETS];
+  uint64_t total;
+  int max;
+} histogram_t;
+
+/**
+  Everything one simulation's scheduler keeps track of. Schedulers share
+  nothing, so each can be driven from its own thread.
+
+  With QUEUE_BUCKET the ready queue is a bucket queue keyed by the field
+  the scheme sorts on first, which are all small integers; the scheme's
+  comparer only orders jobs sharing a bucket. It is intrusive, linking
+  jobs through their own link field rather than allocating list nodes.
+
+  Idle cores are kept as a bitmap, so the lowest idle core is found a word
+  at a time. A running job's remaining_time is only correct as of its
+  since field; sync_job() brings it up to date. All running jobs lose time
+  at the same rate, so their order under the scheme's comparer never
+  changes while they run and the running heap stays valid.
+
+  With RUNQUEUE_PER_CORE every core has a ready queue of its own. A job
+  that cannot run goes to the shortest queue, a preempted or expired job
+  back to its core's queue, and a core only takes jobs from its own queue
+  unless it would otherwise go idle and stealing is on. Every
+  pushInterval time units, jobs move from the longest queue to the
+  shortest of a busy core until they are even.
+
+  Under MLFQ a job's slice is what is left of its level's quantum, kept
+  lazily like remaining_time, so a preempted job resumes with the rest of
+  it. A boost moves queued jobs to level 0 at once; running jobs are only
+  marked, and move when they leave their core.
+
+  Under CFS the queue is ordered by vruntime, the time a job has run
+  scaled by NICE_0_WEIGHT over its weight, so jobs of higher priority
+  age more slowly. A job placed on a core gets its weight's share of
+  cfsLatency, with the load spread over the cores, but never less than
+  cfsGranularity.
+
+  Jobs without a deadline have deadline and period INT_MAX, so EDF and RM
+  run them after every job that has one. The lateness of every job with
+  a deadline is kept, and sorted the first time a percentile is asked for.
+*/
+struct _scheduler_t
+{
+  scheme_t currentScheme;
+  int preemptive;
+  int numCores;
+  int(*comp)(const void *, const void *);
+  float waitingTime, turnaroundTime, responseTime;
+  int numJobs;
+  int currentTime;
+
+  job_t** coreInUse;
+  uint64_t* idleCores;
+  int numIdle;
+  runq_t running;
+  int* runningIndex;
+
+  queue_backend_t queueBackend;
+  int numQueues;
+  jobq_t* queues;
+  priqueue_t* bucketQueues;
+  unsigned int queueSeq;
+
+  int steal;
+  int pushInterval, nextPush;
+  shortq_t shortest;
+  longq_t longest;
+  int* shortestIndex;
+  int* longestIndex;
+  int migrations;
+
+  mlfq_config_t mlfq;
+  int nextBoost;
+
+  int cfsGranularity, cfsLatency;
+  int64_t cfsLoad;
+  uint64_t minVruntime;
+
+  int deadlineMisses;
+  int* lateness;
+  int numLateness, latenessCapacity, latenessSorted;
+
+  histogram_t metrics[METRIC_RESPONSE + 1];
+};
+
+/* A heap shared by all cores; MLFQ with quanta 2, 4 and 8, boosted every 100; CFS with 2 and 12 */
+#define DEFAULT_CONFIG { QUEUE_HEAP, RUNQUEUE_SHARED, 0, 0, { 3, {2, 4, 8}, 100 }, 2, 12 }
+
+static const scheduler_config_t defaultConfig = DEFAULT_CONFIG;
+
+/* The settings scheduler_start_up() uses, which only the scheduler_set_* calls change */
+static scheduler_config_t legacyConfig = DEFAULT_CONFIG;
+
+/* Weight of a job at priority (nice) 0, and of priorities -20 to 19, as in Linux */
+#define NICE_0_WEIGHT 1024
+#define VRUNTIME_SCALE 1024
+
+static const int prio_to_weight[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+/* The scheduler the scheduler_* calls without a context work on */
+scheduler_t defaultScheduler;
+
+/**
+  Brings a running job's remaining time up to the current time.
+*/
+static void sync_job(scheduler_t *s, job_t *job)
+{
+  int elapsed = s->currentTime - job->since;
+  job->remaining_time -= elapsed;
+  job->slice -= elapsed;
+  job->vruntime += (uint64_t)elapsed * NICE_0_WEIGHT * VRUNTIME_SCALE / job->weight;
+  job->since = s->currentTime;
+}
+
+/**
+  Returns the CFS slice of a job about to run: its weight's share of the
+  latency, never below the minimum granularity.
+*/
+static int cfs_slice(scheduler_t *s, job_t *job)
+{
+  int64_t slice = (int64_t)s->cfsLatency * job->weight * s->numCores / s->cfsLoad;
+  return slice > s->cfsGranularity ? (int)slice : s->cfsGranularity;
+}
+
+/* The least preferential job comes first; ties go to the lowest core. */
+static int running_less(const running_t *a, const running_t *b)
+{
+  sync_job(a->s, a->job);
+  sync_job(b->s, b->job);
+  int order = a->s->comp(a->job, b->job);
+  return order != 0 ? order > 0 : a->core < b->core;
+}
+
+static void running_moved(running_t *item, int index)
+{
+  item->s->runningIndex[item->core] = index;
+}
+
+static int queue_size(scheduler_t *s, int q);
+
+/* Ties between queues of the same length go to the lowest core. */
+static int shortest_less(const load_t *a, const load_t *b)
+{
+  int order = queue_size(a->s, a->queue) - queue_size(b->s, b->queue);
+  return order != 0 ? order < 0 : a->queue < b->queue;
+}
+
+static int longest_less(const load_t *a, const load_t *b)
+{
+  int order = queue_size(a->s, a->queue) - queue_size(b->s, b->queue);
+  return order != 0 ? order > 0 : a->queue < b->queue;
+}
+
+static void shortest_moved(load_t *item, int index)
+{
+  item->s->shortestIndex[item->queue] = index;
+}
+
+static void longest_moved(load_t *item, int index)
+{
+  item->s->longestIndex[item->queue] = index;
+}
+
+/**
+  Puts a job (or nothing, for 0) on a core, keeping the idle bitmap and
+  the running heap in step. A job leaving the core is brought up to date
+  first, so it can be queued with the right remaining time.
+*/
+static void set_core(scheduler_t *s, int core, job_t* job)
+{
+  job_t* old = s->coreInUse[core];
+  uint64_t bit = (uint64_t)1 << (core % 64);
+
+  if(old)
+  {
+    sync_job(s, old);
+    if(old->boosted)
+    {
+      old->level = 0;
+      old->slice = s->mlfq.quanta[0];
+      old->boosted = 0;
+    }
+  }
+  if(job)
+  {
+    job->since = s->currentTime;
+    if(job->last_core != -1 && job->last_core != core)
+      s->migrations++;
+    job->last_core = core;
+    if(s->currentScheme == CFS)
+    {
+      job->slice = cfs_slice(s, job);
+      if(job->vruntime > s->minVruntime)
+        s->minVruntime = job->vruntime;
+    }
+  }
+  s->coreInUse[core] = job;
+
+  if(!old && job)
+  {
+    s->idleCores[core / 64] &= ~bit;
+    s->numIdle--;
+  }
+  else if(old && !job)
+  {
+    s->idleCores[core / 64] |= bit;
+    s->numIdle++;
+  }
+
+  if(!s->preemptive)
+    return;
+
+  if(old && job)
+  {
+    s->running.items[s->runningIndex[core]].job = job;
+    runq_update(&s->running, s->runningIndex[core]);
+  }
+  else if(job)
+  {
+    running_t entry;
+    entry.job = job;
+    entry.core = core;
+    entry.s = s;
+    runq_offer(&s->running, entry);
+  }
+  else if(old)
+    runq_remove_at(&s->running, s->runningIndex[core], NULL);
+}
+
+int fcfs(const void *a, const void *b)
+{
+  job_t* joba = (job_t*)a;
+  job_t* jobb = (job_t*)b;
+  if(joba->number == jobb->number)
+    return 0;
+  return joba->arrival_time - jobb->arrival_time;
+}
+
+int sjf(const void *a, const void *b)
+{
+  job_t* joba = (job_t*)a;
+  job_t* jobb = (job_t*)b;
+  if(joba->number == jobb->number)
+    return 0;
+  int diff = joba->remaining_time - jobb->remaining_time;
+  if(diff == 0)
+    return joba->arrival_time - jobb->arrival_time;
+  else
+    return diff;
+}
+
+int pri(const void *a, const void *b)
+{
+  job_t* joba = (job_t*)a;
+  job_t* jobb = (job_t*)b;
+  if(joba->number == jobb->number)
+    return 0;
+  int diff = joba->priority - jobb->priority;
+  if(diff == 0)
+    return joba->arrival_time - jobb->arrival_time;
+  else
+    return diff;
+}
+
+/* Jobs on the same MLFQ level tie, so each level is served round robin. */
+int mlfq(const void *a, const void *b)
+{
+  return ((const job_t*)a)->level - ((const job_t*)b)->level;
+}
+
+int cfs(const void *a, const void *b)
+{
+  const job_t* joba = (const job_t*)a;
+  const job_t* jobb = (const job_t*)b;
+  if(joba->vruntime != jobb->vruntime)
+    return joba->vruntime < jobb->vruntime ? -1 : 1;
+  return joba->arrival_time - jobb->arrival_time;
+}
+
+int edf(const void *a, const void *b)
+{
+  const job_t* joba = (const job_t*)a;
+  const job_t* jobb = (const job_t*)b;
+  if(joba->number == jobb->number)
+    return 0;
+  if(joba->deadline != jobb->deadline)
+    return joba->deadline < jobb->deadline ? -1 : 1;
+  return joba->arrival_time - jobb->arrival_time;
+}
+
+int rm(const void *a, const void *b)
+{
+  const job_t* joba = (const job_t*)a;
+  const job_t* jobb = (const job_t*)b;
+  if(joba->number == jobb->number)
+    return 0;
+  if(joba->period != jobb->period)
+    return joba->period < jobb->period ? -1 : 1;
+  return joba->arrival_time - jobb->arrival_time;
+}
+
+/* Every job ties under RR; the queue hands ties back in the order they were offered. */
+int rr(const void *a, const void *b)
+{
+  UNUSED(a);
+  UNUSED(b);
+  return 0;
+}
+
+int arrival_key(const void *a)
+{
+  return ((const job_t*)a)->arrival_time;
+}
+
+int remaining_key(const void *a)
+{
+  return ((const job_t*)a)->remaining_time;
+}
+
+int priority_key(const void *a)
+{
+  return ((const job_t*)a)->priority;
+}
+
+int level_key(const void *a)
+{
+  return ((const job_t*)a)->level;
+}
+
+int deadline_key(const void *a)
+{
+  return ((const job_t*)a)->deadline;
+}
+
+int period_key(const void *a)
+{
+  return ((const job_t*)a)->period;
+}
+
+int no_key(const void *a)
+{
+  UNUSED(a);
+  return 0;
+}
+
+/**
+  Keeps the shortest and longest queue heaps in step after queue q grew or
+  shrank.
+*/
+static void queue_resized(scheduler_t *s, int q)
+{
+  if(s->numQueues == 1)
+    return;
+  shortq_update(&s->shortest, s->shortestIndex[q]);
+  longq_update(&s->longest, s->longestIndex[q]);
+}
+
+/**
+  Adds a job to ready queue q, keyed the way the scheme's comparer
+  orders it.
+*/
+static void queue_offer(scheduler_t *s, int q, job_t* job)
+{
+  if(s->queueBackend == QUEUE_BUCKET)
+  {
+    priqueue_offer(&s->bucketQueues[q], job);
+    queue_resized(s, q);
+    return;
+  }
+
+  job_key_t entry;
+  entry.job = job;
+  entry.seq = s->queueSeq++;
+
+  switch(s->currentScheme)
+  {
+    case FCFS: entry.key = job->arrival_time;   entry.tie = 0;                 break;
+    case SJF:
+    case PSJF: entry.key = job->remaining_time; entry.tie = job->arrival_time; break;
+    case PRI:
+    case PPRI: entry.key = job->priority;       entry.tie = job->arrival_time; break;
+    case MLFQ: entry.key = job->level;          entry.tie = 0;                 break;
+    // vruntime outgrows an int, so its high and low bits are the key and the tie
+    case CFS:  entry.key = (int)(job->vruntime >> 31);
+               entry.tie = (int)(job->vruntime & 0x7fffffff);                  break;
+    case EDF:  entry.key = job->deadline;       entry.tie = job->arrival_time; break;
+    case RM:   entry.key = job->period;         entry.tie = job->arrival_time; break;
+    default:   entry.key = 0;                   entry.tie = 0;                 break;
+  }
+
+  jobq_offer(&s->queues[q], entry);
+  queue_resized(s, q);
+}
+
+static job_t* queue_poll(scheduler_t *s, int q)
+{
+  job_t* job = 0;
+  job_key_t entry;
+
+  if(s->queueBackend == QUEUE_BUCKET)
+    job = priqueue_poll(&s->bucketQueues[q]);
+  else if(jobq_poll(&s->queues[q], &entry))
+    job = entry.job;
+
+  queue_resized(s, q);
+  return job;
+}
+
+/**
+  Removes the job that would run last from queue q. The heap is sorted
+  first, so which job moves does not depend on whether something else
+  (scheduler_show_queue()) happened to sort it already.
+*/
+static job_t* queue_take_last(scheduler_t *s, int q)
+{
+  job_t* job;
+  job_key_t entry;
+
+  if(s->queueBackend == QUEUE_BUCKET)
+    job = priqueue_remove_at(&s->bucketQueues[q], priqueue_size(&s->bucketQueues[q]) - 1);
+  else
+  {
+    jobq_order(&s->queues[q]);
+    jobq_remove_at(&s->queues[q], jobq_size(&s->queues[q]) - 1, &entry);
+    job = entry.job;
+  }
+
+  queue_resized(s, q);
+  return job;
+}
+
+static int queue_size(scheduler_t *s, int q)
+{
+  if(s->queueBackend == QUEUE_BUCKET)
+    return priqueue_size(&s->bucketQueues[q]);
+  return jobq_size(&s->queues[q]);
+}
+
+/* The queue a core puts its own jobs back in */
+static int core_queue(scheduler_t *s, int core)
+{
+  return s->numQueues == 1 ? 0 : core;
+}
+
+/**
+  Returns the queue a core should run its next job from: its own, or, if
+  that is empty and stealing is on, the longest one.
+*/
+static int next_queue(scheduler_t *s, int core)
+{
+  int q = core_queue(s, core);
+  if(queue_size(s, q) == 0 && s->steal && s->numQueues > 1)
+    q = longq_peek(&s->longest)->queue;
+  return q;
+}
+
+/**
+  Returns the shortest queue of a core that is running a job, or -1 if
+  every core is idle. Ties go to the lowest core, as in the shortest heap.
+*/
+static int shortest_busy_queue(scheduler_t *s)
+{
+  int q, best = -1;
+
+  if(s->coreInUse[shortq_peek(&s->shortest)->queue])
+    return shortq_peek(&s->shortest)->queue;
+
+  for(q = 0; q < s->numQueues; q++)
+    if(s->coreInUse[q] && (best == -1 || queue_size(s, q) < queue_size(s, best)))
+      best = q;
+  return best;
+}
+
+/**
+  Moves queued jobs from the longest queue to the shortest until no two
+  queues differ by more than one, if a push is due. Jobs are never pushed
+  to an idle core: it only takes work when a scheduler call hands it some,
+  so they would be stranded there.
+*/
+static void push_balance(scheduler_t *s, int time)
+{
+  if(s->pushInterval <= 0 || s->numQueues == 1 || time < s->nextPush)
+    return;
+  s->nextPush = time - time % s->pushInterval + s->pushInterval;
+
+  while(1)
+  {
+    int from = longq_peek(&s->longest)->queue;
+    int to = shortest_busy_queue(s);
+    if(to == -1 || queue_size(s, from) - queue_size(s, to) <= 1)
+      break;
+    queue_offer(s, to, queue_take_last(s, from));
+  }
+}
+
+/**
+  Moves every job to MLFQ level 0, if a boost is due. Queued jobs are
+  requeued in the order they would have run.
+*/
+static void mlfq_boost(scheduler_t *s, int time)
+{
+  int q, i, n;
+
+  if(s->currentScheme != MLFQ || s->mlfq.boost_interval <= 0 || time < s->nextBoost)
+    return;
+  s->nextBoost = time - time % s->mlfq.boost_interval + s->mlfq.boost_interval;
+
+  for(q = 0; q < s->numQueues; q++)
+  {
+    n = queue_size(s, q);
+    if(n == 0)
+      continue;
+
+    job_t** jobs = malloc(sizeof(job_t*) * n);
+    if(jobs == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      exit(2);
+    }
+    for(i = 0; i < n; i++)
+    {
+      jobs[i] = queue_poll(s, q);
+      jobs[i]->level = 0;
+      jobs[i]->slice = s->mlfq.quanta[0];
+    }
+    for(i = 0; i < n; i++)
+      queue_offer(s, q, jobs[i]);
+    free(jobs);
+  }
+
+  for(i = 0; i < s->numCores; i++)
+    if(s->coreInUse[i] && s->coreInUse[i]->level > 0)
+      s->coreInUse[i]->boosted = 1;
+}
+
+/* How far a value is shifted to land in the top half of the sub-buckets; 0 in the exact range */
+static int histogram_shift(int value)
+{
+  return 31 - __builtin_clz((unsigned int)value | HISTOGRAM_HALF) - 6;
+}
+
+static void histogram_record(histogram_t *h, int value)
+{
+  if(value < 0)
+    value = 0;
+  int shift = histogram_shift(value);
+  h->counts[shift * HISTOGRAM_HALF + (value >> shift)]++;
+  h->total++;
+  if(value > h->max)
+    h->max = value;
+}
+
+/**
+  Returns the nearest rank of a percentile among count values, from 1 to
+  count. Percentiles such as 99.9 are not exact in binary, so positions
+  within a relative 1e-12 above a whole rank are taken as that rank
+  rather than rounded up to the next.
+*/
+static uint64_t nearest_rank(double percentile, uint64_t count)
+{
+  double position = percentile / 100.0 * count;
+  position -= position * 1e-12;
+
+  uint64_t rank = position > 0 ? (uint64_t)position : 0;
+  if(rank < position)
+    rank++;
+  if(rank < 1)
+    rank = 1;
+  if(rank > count)
+    rank = count;
+  return rank;
+}
+
+/**
+  Returns the value the given percentage of recorded values are at or
+  under, by the nearest-rank method: the highest value of the bucket that
+  rank falls in, or the exact maximum if that is lower.
+*/
+static int histogram_percentile(histogram_t *h, double percentile)
+{
+  uint64_t seen = 0;
+  int i;
+
+  if(h->total == 0)
+    return 0;
+
+  uint64_t rank = nearest_rank(percentile, h->total);
+
+  for(i = 0; i < HISTOGRAM_BUCKETS; i++)
+  {
+    seen += h->counts[i];
+    if(seen >= rank)
+      break;
+  }
+
+  int shift = i < HISTOGRAM_SUB_BUCKETS ? 0 : i / HISTOGRAM_HALF - 1;
+  int64_t highest = ((int64_t)(i - shift * HISTOGRAM_HALF + 1) << shift) - 1;
+  return highest < h->max ? (int)highest : h->max;
+}
+
+/**
+  Keeps the lateness of a job that had a deadline; positive means it
+  finished late.
+*/
+static void record_lateness(scheduler_t *s, int lateness)
+{
+  if(s->numLateness == s->latenessCapacity)
+  {
+    s->latenessCapacity = s->latenessCapacity ? s->latenessCapacity * 2 : 64;
+    s->lateness = realloc(s->lateness, sizeof(int) * s->latenessCapacity);
+    if(s->lateness == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      exit(2);
+    }
+  }
+  s->lateness[s->numLateness++] = lateness;
+  s->latenessSorted = 0;
+  if(lateness > 0)
+    s->deadlineMisses++;
+}
+
+static int compare_int(const void *a, const void *b)
+{
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+  Fills in the default settings: one ready queue, a heap, shared by every
+  core; MLFQ with 3 levels of quanta 2, 4 and 8, boosted every 100 time
+  units; and CFS with a minimum granularity of 2 and a latency of 12.
+
+  @param config the settings to fill in
+*/
+void scheduler_config_default(scheduler_config_t *config)
+{
+  *config = defaultConfig;
+}
+
+/**
+  Selects the data structure holding the ready queue of the default
+  scheduler when scheduler_start_up() is next called; the default is
+  QUEUE_HEAP. Schedulers started with a scheduler_config_t are not
+  affected.
+
+  @param backend the data structure to use
+*/
+void scheduler_set_queue_backend(queue_backend_t backend)
+{
+  legacyConfig.queue_backend = backend;
+}
+
+/**
+  Selects how the default scheduler queues ready jobs when
+  scheduler_start_up() is next called.
+
+  @param mode RUNQUEUE_SHARED for one queue (the default) or
+  RUNQUEUE_PER_CORE for one per core
+  @param steal with per-core queues, whether a core whose queue is empty
+  takes a job from the longest queue instead of going idle
+  @param push_interval with per-core queues, how often jobs are moved to
+  even out the queues, in time units (0 for never)
+*/
+void scheduler_set_run_queues(runqueue_mode_t mode, int steal, int push_interval)
+{
+  legacyConfig.run_queues = mode;
+  legacyConfig.steal = steal;
+  legacyConfig.push_interval = push_interval;
+}
+
+/**
+  Sets the levels, quanta and boost interval the default scheduler uses
+  under MLFQ when scheduler_start_up() is next called; the default is 3
+  levels with quanta 2, 4 and 8, boosted every 100 time units.
+
+  @param config the MLFQ shape, with 1 to MLFQ_MAX_LEVELS positive quanta
+*/
+void scheduler_set_mlfq(const mlfq_config_t *config)
+{
+  legacyConfig.mlfq = *config;
+}
+
+/**
+  Sets the MLFQ shape of one scheduler. Call it before the scheduler's
+  first job arrives.
+
+  @param s a pointer to the scheduler
+  @param config the MLFQ shape, with 1 to MLFQ_MAX_LEVELS positive quanta
+*/
+void scheduler_set_mlfq_r(scheduler_t *s, const mlfq_config_t *config)
+{
+  s->mlfq = *config;
+  s->nextBoost = config->boost_interval;
+}
+
+/**
+  Sets the minimum granularity and target latency the default scheduler
+  uses under CFS when scheduler_start_up() is next called; the defaults
+  are 2 and 12 time units.
+
+  @param min_granularity the least time a job runs once placed on a core
+  @param latency the time over which every job in the system should get
+  to run, split between jobs by weight
+*/
+void scheduler_set_cfs(int min_granularity, int latency)
+{
+  legacyConfig.cfs_granularity = min_granularity;
+  legacyConfig.cfs_latency = latency;
+}
+
+/**
+  Sets the CFS minimum granularity and target latency of one scheduler.
+
+  @param s a pointer to the scheduler
+  @param min_granularity the least time a job runs once placed on a core
+  @param latency the time over which every job in the system should get
+  to run
+*/
+void scheduler_set_cfs_r(scheduler_t *s, int min_granularity, int latency)
+{
+  s->cfsGranularity = min_granularity;
+  s->cfsLatency = latency;
+}
+
+/**
+  Initalizes a scheduler.
+
+  @param s a pointer to the scheduler to initialize
+  @param cores the number of cores
+  @param scheme the scheduling scheme
+  @param config the scheduler's settings, or NULL for the defaults
+*/
+void scheduler_start_up_r(scheduler_t *s, int cores, scheme_t scheme, const scheduler_config_t *config)
+{
+  if(config == NULL)
+    config = &defaultConfig;
+
+  s->waitingTime = 0.0;
+  s->turnaroundTime = 0.0;
+  s->responseTime = 0.0;
+  s->numJobs = 0;
+  s->currentTime = 0;
+
+  s->numCores = cores;
+  s->currentScheme = scheme;
+
+  s->coreInUse = malloc(sizeof(job_t) * cores);
+  s->idleCores = malloc(sizeof(uint64_t) * ((cores + 63) / 64));
+  s->runningIndex = malloc(sizeof(int) * cores);
+  s->numIdle = cores;
+  runq_init(&s->running);
+
+  int i = 0;
+  while(i < cores)
+  {
+    s->coreInUse[i] = 0;
+    i++;
+  }
+  for(i = 0; i < (cores + 63) / 64; i++)
+    s->idleCores[i] = ~(uint64_t)0;
+  if(cores % 64)
+    s->idleCores[cores / 64] = ((uint64_t)1 << (cores % 64)) - 1;
+
+  switch(scheme)
+  {
+    case FCFS: s->comp = fcfs; s->preemptive = 0; break;
+    case SJF:  s->comp = sjf;  s->preemptive = 0; break;
+    case PSJF: s->comp = sjf;  s->preemptive = 1; break;
+    case PRI:  s->comp = pri;  s->preemptive = 0; break;
+    case PPRI: s->comp = pri;  s->preemptive = 1; break;
+    case RR:   s->comp = rr;   s->preemptive = 0; break;
+    case MLFQ: s->comp = mlfq; s->preemptive = 1; break;
+    case CFS:  s->comp = cfs;  s->preemptive = 0; break;
+    case EDF:  s->comp = edf;  s->preemptive = 1; break;
+    case RM:   s->comp = rm;   s->preemptive = 1; break;
+  }
+  scheduler_set_mlfq_r(s, &config->mlfq);
+  scheduler_set_cfs_r(s, config->cfs_granularity, config->cfs_latency);
+  s->cfsLoad = 0;
+  s->minVruntime = 0;
+  s->deadlineMisses = 0;
+  s->lateness = 0;
+  s->numLateness = 0;
+  s->latenessCapacity = 0;
+  s->latenessSorted = 1;
+  memset(s->metrics, 0, sizeof(s->metrics));
+
+  // vruntime is no small integer to bucket by, so CFS always uses the heap
+  s->queueSeq = 0;
+  s->queueBackend = scheme == CFS ? QUEUE_HEAP : config->queue_backend;
+  s->numQueues = config->run_queues == RUNQUEUE_PER_CORE ? cores : 1;
+  s->queues = malloc(sizeof(jobq_t) * s->numQueues);
+  s->bucketQueues = malloc(sizeof(priqueue_t) * s->numQueues);
+
+  for(i = 0; i < s->numQueues; i++)
+  {
+    jobq_init(&s->queues[i]);
+    if(s->queueBackend == QUEUE_BUCKET)
+    {
+      switch(scheme)
+      {
+        case FCFS: priqueue_init_bucket(&s->bucketQueues[i], s->comp, arrival_key);   break;
+        case SJF:
+        case PSJF: priqueue_init_bucket(&s->bucketQueues[i], s->comp, remaining_key); break;
+        case PRI:
+        case PPRI: priqueue_init_bucket(&s->bucketQueues[i], s->comp, priority_key);  break;
+        case RR:   priqueue_init_bucket(&s->bucketQueues[i], s->comp, no_key);        break;
+        case MLFQ: priqueue_init_bucket(&s->bucketQueues[i], s->comp, level_key);     break;
+        case CFS:  break;
+        case EDF:  priqueue_init_bucket(&s->bucketQueues[i], s->comp, deadline_key);  break;
+        case RM:   priqueue_init_bucket(&s->bucketQueues[i], s->comp, period_key);    break;
+      }
+      priqueue_set_intrusive(&s->bucketQueues[i], offsetof(job_t, link));
+    }
+  }
+
+  s->steal = config->steal;
+  s->pushInterval = config->push_interval;
+  s->nextPush = config->push_interval;
+  s->migrations = 0;
+  s->shortestIndex = malloc(sizeof(int) * s->numQueues);
+  s->longestIndex = malloc(sizeof(int) * s->numQueues);
+  shortq_init(&s->shortest);
+  longq_init(&s->longest);
+  if(s->numQueues > 1)
+  {
+    for(i = 0; i < s->numQueues; i++)
+    {
+      load_t load;
+      load.queue = i;
+      load.s = s;
+      shortq_offer(&s->shortest, load);
+      longq_offer(&s->longest, load);
+    }
+  }
+}
+
+/**
+  Allocates and initializes a scheduler of its own, independent of the
+  default one and of any other.
+
+  @param cores the number of cores
+  @param scheme the scheduling scheme
+  @param config the scheduler's settings, or NULL for the defaults
+  @return the scheduler, to be released with scheduler_destroy()
+*/
+scheduler_t* scheduler_create(int cores, scheme_t scheme, const scheduler_config_t *config)
+{
+  scheduler_t* s = malloc(sizeof(scheduler_t));
+  if(s == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    exit(2);
+  }
+  scheduler_start_up_r(s, cores, scheme, config);
+  return s;
+}
+
+/**
+  Returns the scheduler that the scheduler_* calls without a scheduler_t
+  argument work on.
+*/
+scheduler_t* scheduler_default()
+{
+  return &defaultScheduler;
+}
+
+/**
+  Initalizes the scheduler.
+
+  Assumptions:
+    - You may assume this will be the first scheduler function called.
+    - You may assume this function will be called once once.
+    - You may assume that cores is a positive, non-zero number.
+    - You may assume that scheme is a valid scheduling scheme.
+
+  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
+  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+*/
+void scheduler_start_up(int cores, scheme_t scheme)
+{
+  scheduler_start_up_r(&defaultScheduler, cores, scheme, &legacyConfig);
+}
+
+
+/**
+  scheduler_new_job() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_new_job_r(scheduler_t *s, int job_number, int time, int running_time, int priority)
+{
+  return scheduler_new_deadline_job_r(s, job_number, time, running_time, priority, 0);
+}
+
+/**
+  scheduler_new_deadline_job() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_new_deadline_job_r(scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline)
+{
+  deincrement_Remaining_Times_r(s, time);
+  push_balance(s, time);
+  mlfq_boost(s, time);
+
+  job_t* job = calloc(1, sizeof(job_t));
+  job->number = job_number;
+  job->arrival_time = time;
+  job->start_time = -1;
+  job->last_core = -1;
+  job->slice = s->mlfq.quanta[0];
+  job->running_time = running_time;
+  job->remaining_time = running_time;
+  job->priority = priority;
+  job->weight = prio_to_weight[(priority < -20 ? -20 : priority > 19 ? 19 : priority) + 20];
+  job->vruntime = s->minVruntime;
+  s->cfsLoad += job->weight;
+  job->period = deadline > 0 ? deadline : INT_MAX;
+  job->deadline = deadline > 0 && time <= INT_MAX - deadline ? time + deadline : INT_MAX;
+
+  int core = are_Any_Cores_Idle_r(s);
+  if(core != -1)
+  {
+    job->start_time = time;
+    // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
+    //         job->number, job->arrival_time, job->start_time);
+    set_core(s, core, job);
+    return core;
+  }
+
+  if(s->preemptive)
+  {
+    core = get_Least_Preferential_Job_r(s, job);
+    if(core > -1)
+    {
+      job_t* temp = s->coreInUse[core];
+      if(time == temp->start_time)
+      {
+        temp->start_time = -1;
+        // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
+        //         temp->number, temp->arrival_time, temp->start_time);
+      }
+      job->start_time = time;
+      // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
+      //         job->number, job->arrival_time, job->start_time);
+      set_core(s, core, job);
+      queue_offer(s, core_queue(s, core), temp);
+      return core;
+    }
+  }
+
+  queue_offer(s, s->numQueues == 1 ? 0 : shortq_peek(&s->shortest)->queue, job);
+
+  return -1;
+}
+
+/**
+  Called when a new job arrives.
+
+  If multiple cores are idle, the job should be assigned to the core with the
+  lowest id.
+  If the job arriving should be scheduled to run during the next
+  time cycle, return the zero-based index of the core the job should be
+  scheduled on. If another job is already running on the core specified,
+  this will preempt the currently running job.
+  Assumptions:
+    - You may assume that every job wil have a unique arrival time.
+
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+
+ */
+int scheduler_new_job(int job_number, int time, int running_time, int priority)
+{
+  return scheduler_new_job_r(&defaultScheduler, job_number, time, running_time, priority);
+}
+
+/**
+  Called instead of scheduler_new_job() when the job has a deadline. EDF
+  runs the job with the earliest absolute deadline (time + deadline); RM
+  treats deadline as the job's period and runs the shortest period first.
+
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @param deadline the time after arrival the job should finish by, or 0 if it has none.
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+ */
+int scheduler_new_deadline_job(int job_number, int time, int running_time, int priority, int deadline)
+{
+  return scheduler_new_deadline_job_r(&defaultScheduler, job_number, time, running_time, priority, deadline);
+}
+
+
+/**
+  scheduler_job_finished() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_job_finished_r(scheduler_t *s, int core_id, int job_number, int time)
+{
+  deincrement_Remaining_Times_r(s, time);
+  push_balance(s, time);
+  mlfq_boost(s, time);
+
+  job_t* finJob = s->coreInUse[core_id];
+  s->cfsLoad -= finJob->weight;
+  s->numJobs++;
+  s->waitingTime += (time - finJob->arrival_time - finJob->running_time);
+  s->turnaroundTime += (time - finJob->arrival_time);
+  s->responseTime+=(finJob->start_time - finJob->arrival_time);
+  histogram_record(&s->metrics[METRIC_WAITING], time - finJob->arrival_time - finJob->running_time);
+  histogram_record(&s->metrics[METRIC_TURNAROUND], time - finJob->arrival_time);
+  histogram_record(&s->metrics[METRIC_RESPONSE], finJob->start_time - finJob->arrival_time);
+  if(finJob->period != INT_MAX)
+    record_lateness(s, time - finJob->deadline);
+  // printf("---Added %d to response time.\n",finJob->start_time - finJob->arrival_time);
+
+
+  set_core(s, core_id, 0);
+  free(finJob);
+
+  int q = next_queue(s, core_id);
+  if(queue_size(s, q) > 0)
+  {
+    job_t* job = queue_poll(s, q);
+    if(job->start_time == -1)
+    {
+      job->start_time = time;
+      // printf("CHANGING START TIME ROFLCOPTER: job: %d arrival: %d start: %d\n",
+      //         job->number, job->arrival_time, job->start_time);
+    }
+    set_core(s, core_id, job);
+    return job->number;
+  }
+
+	return -1;
+}
+
+/**
+  Called when a job has completed execution.
+
+  The core_id, job_number and time parameters are provided for convenience. You may be able to calculate the values with your own data structure.
+  If any job should be scheduled to run on the core free'd up by the
+  finished job, return the job_number of the job that should be scheduled to
+  run on core core_id.
+
+  @param core_id the zero-based index of the core where the job was located.
+  @param job_number a globally unique identification number of the job.
+  @param time the current time of the simulator.
+  @return job_number of the job that should be scheduled to run on core core_id
+  @return -1 if core should remain idle.
+ */
+int scheduler_job_finished(int core_id, int job_number, int time)
+{
+  return scheduler_job_finished_r(&defaultScheduler, core_id, job_number, time);
+}
+
+
+/**
+  scheduler_quantum_expired() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_quantum_expired_r(scheduler_t *s, int core_id, int time)
+{
+  deincrement_Remaining_Times_r(s, time);
+  push_balance(s, time);
+  mlfq_boost(s, time);
+
+  job_t* job = s->coreInUse[core_id];
+  int q = core_queue(s, core_id);
+
+  // Under MLFQ the job used up its slice, so it drops a level (or goes back to the top if boosted)
+  if(s->currentScheme == MLFQ)
+  {
+    sync_job(s, job);
+    job->level = job->boosted ? 0 : job->level + (job->level + 1 < s->mlfq.levels);
+    job->slice = s->mlfq.quanta[job->level];
+    job->boosted = 0;
+    runq_update(&s->running, s->runningIndex[core_id]);
+  }
+
+  if(queue_size(s, q) > 0)
+  {
+    job_t* expired = job;
+    sync_job(s, expired);
+    queue_offer(s, q, expired);
+    job = queue_poll(s, q);
+    if(job->start_time == -1)
+      job->start_time = time;
+    if(job != expired)
+      set_core(s, core_id, job);
+  }
+
+  // A CFS job that keeps its core starts a new slice
+  if(s->currentScheme == CFS && job == s->coreInUse[core_id])
+  {
+    sync_job(s, job);
+    job->slice = cfs_slice(s, job);
+  }
+  return job->number;
+}
+
+/**
+  When the scheme is set to RR, MLFQ or CFS, called when the quantum timer has expired
+  on a core.
+
+  If any job should be scheduled to run on the core free'd up by
+  the quantum expiration, return the job_number of the job that should be
+  scheduled to run on core core_id.
+
+  @param core_id the zero-based index of the core where the quantum has expired.
+  @param time the current time of the simulator.
+  @return job_number of the job that should be scheduled on core cord_id
+  @return -1 if core should remain idle
+ */
+int scheduler_quantum_expired(int core_id, int time)
+{
+  return scheduler_quantum_expired_r(&defaultScheduler, core_id, time);
+}
+
+
+/**
+  scheduler_time_slice() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_time_slice_r(scheduler_t *s, int core_id)
+{
+  job_t* job = s->coreInUse[core_id];
+  if((s->currentScheme != MLFQ && s->currentScheme != CFS) || job == 0)
+    return -1;
+  sync_job(s, job);
+  return job->slice;
+}
+
+/**
+  Returns how long the job on a core may run before its quantum expires,
+  for schemes where the scheduler sets the quantum (MLFQ, CFS). Under RR the
+  simulator keeps one quantum for every job itself.
+
+  @param core_id the zero-based index of the core
+  @return the time units left of the job's quantum
+  @return -1 if the core is idle or the scheme has no per-job quantum
+ */
+int scheduler_time_slice(int core_id)
+{
+  return scheduler_time_slice_r(&defaultScheduler, core_id);
+}
+
+
+/**
+  scheduler_switch_cost() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+void scheduler_switch_cost_r(scheduler_t *s, int core_id, int cost)
+{
+  job_t* job = s->coreInUse[core_id];
+  if(job == 0 || cost <= 0)
+    return;
+
+  sync_job(s, job);
+  job->remaining_time += cost;
+  job->slice += cost;
+  if(s->preemptive)
+    runq_update(&s->running, s->runningIndex[core_id]);
+}
+
+/**
+  Called when the simulator charges the job just put on a core for the
+  switch to it. The job spends cost more time units on the core without
+  getting work done, so its remaining time and its slice both grow by
+  cost, the way the simulator's own clocks do.
+
+  @param core_id the zero-based index of the core
+  @param cost the time units the switch takes
+ */
+void scheduler_switch_cost(int core_id, int cost)
+{
+  scheduler_switch_cost_r(&defaultScheduler, core_id, cost);
+}
+
+
+/**
+  scheduler_average_waiting_time() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+float scheduler_average_waiting_time_r(scheduler_t *s)
+{
+  if(s->numJobs > 0)
+  {
+    return s->waitingTime/s->numJobs;
+  }
+	return 0.0;
+}
+
+/**
+  Returns the average waiting time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @return the average waiting time of all jobs scheduled.
+ */
+float scheduler_average_waiting_time()
+{
+  return scheduler_average_waiting_time_r(&defaultScheduler);
+}
+
+
+/**
+  scheduler_average_turnaround_time() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+float scheduler_average_turnaround_time_r(scheduler_t *s)
+{
+  if(s->numJobs > 0)
+  {
+    return s->turnaroundTime/s->numJobs;
+  }
+	return 0.0;
+}
+
+/**
+  Returns the average turnaround time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @return the average turnaround time of all jobs scheduled.
+ */
+float scheduler_average_turnaround_time()
+{
+  return scheduler_average_turnaround_time_r(&defaultScheduler);
+}
+
+
+/**
+  scheduler_average_response_time() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+float scheduler_average_response_time_r(scheduler_t *s)
+{
+  if(!s->preemptive && s->comp != rr && s->comp != cfs)
+    return s->waitingTime/s->numJobs;
+  else
+    return s->responseTime/s->numJobs;
+}
+
+/**
+  Returns the average response time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @return the average response time of all jobs scheduled.
+ */
+float scheduler_average_response_time()
+{
+  return scheduler_average_response_time_r(&defaultScheduler);
+}
+
+
+/**
+  scheduler_clean_up() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+void scheduler_clean_up_r(scheduler_t *s)
+{
+  int i;
+  for(i = 0; i < s->numQueues; i++)
+  {
+    jobq_destroy(&s->queues[i]);
+    if(s->queueBackend == QUEUE_BUCKET)
+      priqueue_destroy(&s->bucketQueues[i]);
+  }
+  free(s->queues);
+  free(s->bucketQueues);
+  shortq_destroy(&s->shortest);
+  longq_destroy(&s->longest);
+  free(s->shortestIndex);
+  free(s->longestIndex);
+  free(s->lateness);
+  free(s->coreInUse);
+  free(s->idleCores);
+  free(s->runningIndex);
+  runq_destroy(&s->running);
+  s->coreInUse = 0;
+}
+
+/**
+  Cleans up and frees a scheduler made by scheduler_create().
+
+  @param s a pointer to the scheduler
+*/
+void scheduler_destroy(scheduler_t *s)
+{
+  scheduler_clean_up_r(s);
+  free(s);
+}
+
+/**
+  Free any memory associated with your scheduler.
+
+  Assumptions:
+    - This function will be the last function called in your library.
+*/
+void scheduler_clean_up()
+{
+  scheduler_clean_up_r(&defaultScheduler);
+}
+
+
+/**
+  scheduler_show_queue() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+void scheduler_show_queue_r(scheduler_t *s)
+{
+  int x = 0, q, queued = 0;
+  for(q = 0; q < s->numQueues; q++)
+    queued += queue_size(s, q);
+  if(queued == 0)
+  {
+    printf("Queue is empty");
+    return;
+  }
+
+  // Per-core queues are listed one after another, each line naming its core
+  for(q = 0; q < s->numQueues; q++)
+  {
+    priqueue_iter_t it;
+    if(s->queueBackend == QUEUE_BUCKET)
+      priqueue_iter_begin(&s->bucketQueues[q], &it);
+    else
+      jobq_order(&s->queues[q]);
+
+    for(x = 0; x < queue_size(s, q); x++)
+    {
+      job_t* job = s->queueBackend == QUEUE_BUCKET ? priqueue_iter_next(&it) : s->queues[q].items[x].job;
+      if(s->numQueues > 1)
+        printf("Core %d ", q);
+      printf("Index: %d Job Number:%d Arrival Time: %d Remaining Time: %d Priority: %d\n",
+             x, job->number, job->arrival_time, job->remaining_time, job->priority);
+    }
+  }
+}
+
+/**
+  Returns how many times a job started running on a different core from
+  the one it last ran on.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_migrations_r(scheduler_t *s)
+{
+  return s->migrations;
+}
+
+/**
+  scheduler_migrations_r() for the default scheduler.
+*/
+int scheduler_migrations()
+{
+  return scheduler_migrations_r(&defaultScheduler);
+}
+
+/**
+  Returns the fraction of the finished jobs with a deadline that finished
+  after it, or 0.0 if none had one.
+
+  @param s a pointer to the scheduler
+*/
+float scheduler_deadline_miss_rate_r(scheduler_t *s)
+{
+  if(s->numLateness == 0)
+    return 0.0;
+  return (float)s->deadlineMisses / s->numLateness;
+}
+
+/**
+  scheduler_deadline_miss_rate_r() for the default scheduler.
+*/
+float scheduler_deadline_miss_rate()
+{
+  return scheduler_deadline_miss_rate_r(&defaultScheduler);
+}
+
+/**
+  Returns the lateness (finish time minus deadline, negative when early)
+  that the given percentage of the finished jobs with a deadline came in
+  at or under, by the nearest-rank method.
+
+  @param s a pointer to the scheduler
+  @param percentile from 0 to 100; 100 gives the greatest lateness
+  @return the lateness, or 0 if no finished job had a deadline
+*/
+int scheduler_lateness_percentile_r(scheduler_t *s, double percentile)
+{
+  if(s->numLateness == 0)
+    return 0;
+  if(!s->latenessSorted)
+  {
+    qsort(s->lateness, s->numLateness, sizeof(int), compare_int);
+    s->latenessSorted = 1;
+  }
+
+  return s->lateness[nearest_rank(percentile, s->numLateness) - 1];
+}
+
+/**
+  scheduler_lateness_percentile_r() for the default scheduler.
+*/
+int scheduler_lateness_percentile(double percentile)
+{
+  return scheduler_lateness_percentile_r(&defaultScheduler, percentile);
+}
+
+/**
+  scheduler_percentile() for the scheduler s.
+
+  @param s a pointer to the scheduler
+*/
+int scheduler_percentile_r(scheduler_t *s, metric_t metric, double percentile)
+{
+  return histogram_percentile(&s->metrics[metric], percentile);
+}
+
+/**
+  Returns a percentile of the waiting, turnaround or response times of
+  the finished jobs. The times are kept in a log-bucketed histogram, so
+  the result may be up to 1/64 above the true value, except for the
+  maximum (percentile 100), which is exact.
+
+  @param metric which of the times
+  @param percentile from 0 to 100, such as 50, 99 or 99.9
+  @return the time, or 0 if no job has finished
+ */
+int scheduler_percentile(metric_t metric, double percentile)
+{
+  return scheduler_percentile_r(&defaultScheduler, metric, percentile);
+}
+
+/**
+  This function may print out any debugging information you choose. This
+  function will be called by the simulator after every call the simulator
+  makes to your scheduler.
+  In our provided output, we have implemented this function to list the jobs in the order they are to be scheduled.
+  Furthermore, we have also listed the current state of the job (either running on a given core or idle).
+  For example, if we have a non-preemptive algorithm and job(id=4) has began running, job(id=2) arrives with a higher priority,
+  and job(id=1) arrives with a lower priority, the output in our sample output will be:
+
+    2(-1) 4(0) 1(-1)
+
+  This function is not required and will not be graded. You may leave it
+  blank if you do not find it useful.
+ */
+void scheduler_show_queue()
+{
+  scheduler_show_queue_r(&defaultScheduler);
+}
+
+int are_Any_Cores_Idle_r(scheduler_t *s)
+{
+  int i = 0;
+  if(s->numIdle == 0)
+    return -1;
+  while(s->idleCores[i] == 0)
+    i++;
+  return i * 64 + __builtin_ctzll(s->idleCores[i]);
+}
+
+int are_Any_Cores_Idle()
+{
+  return are_Any_Cores_Idle_r(&defaultScheduler);
+}
+
+/* Running jobs catch up with the clock lazily, through sync_job(). */
+void deincrement_Remaining_Times_r(scheduler_t *s, int time)
+{
+  s->currentTime = time;
+}
+
+void deincrement_Remaining_Times(int time)
+{
+  deincrement_Remaining_Times_r(&defaultScheduler, time);
+}
+
+int get_Least_Preferential_Job_r(scheduler_t *s, void* job)
+{
+  job_t* currentJob = (job_t*)job;
+  int core = -1;
+
+  if(s->preemptive)
+  {
+    running_t* top = runq_peek(&s->running);
+    if(top == NULL)
+      return -1;
+    sync_job(s, top->job);
+    return s->comp(currentJob, top->job) < 0 ? top->core : -1;
+  }
+
+  int i = 0;
+  while(i < s->numCores)
+  {
+    if(s->coreInUse[i])
+      sync_job(s, s->coreInUse[i]);
+    if(s->comp(currentJob,s->coreInUse[i]) < 0)
+    {
+      core = i;
+      currentJob = s->coreInUse[i];
+    }
+    i++;
+  }
+  return core;
+}
+
+int get_Least_Preferential_Job(void* job)
+{
+  return get_Least_Preferential_Job_r(&defaultScheduler, job);
+}
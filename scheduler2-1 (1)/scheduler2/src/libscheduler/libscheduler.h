@@ -1,26 +1,125 @@
-/** @file libscheduler.h
- */
-
-#ifndef LIBSCHEDULER_H_
-#define LIBSCHEDULER_H_
-
-/**
-  Constants which represent the different scheduling algorithms
-*/
-typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR} scheme_t;
-
-void  scheduler_start_up               (int cores, scheme_t scheme);
-int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
-int   scheduler_job_finished           (int core_id, int job_number, int time);
-int   scheduler_quantum_expired        (int core_id, int time);
-float scheduler_average_turnaround_time();
-float scheduler_average_waiting_time   ();
-float scheduler_average_response_time  ();
-void  scheduler_clean_up               ();
-
-void  scheduler_show_queue             ();
-int  are_Any_Cores_Idle                ();
-void deincrement_Remaining_Times         (int time);
-int get_Least_Preferential_Job(void* job);
-
-#endif /* LIBSCHEDULER_H_ */
+/** @file libscheduler.h
+ */
+
+#ifndef LIBSCHEDULER_H_
+#define LIBSCHEDULER_H_
+
+/**
+  Constants which represent the different scheduling algorithms
+*/
+typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR, MLFQ, CFS, EDF, RM} scheme_t;
+
+/**
+  Most levels an MLFQ scheduler can have
+*/
+#define MLFQ_MAX_LEVELS 8
+
+/**
+  Shape of an MLFQ scheduler. New jobs start on level 0, the highest. A
+  job that uses up its level's quantum moves down a level, and every
+  boost_interval time units (0 for never) all jobs go back to level 0.
+*/
+typedef struct _mlfq_config_t
+{
+  int levels;
+  int quanta[MLFQ_MAX_LEVELS];
+  int boost_interval;
+} mlfq_config_t;
+
+/**
+  Data structures that can hold the ready queue
+*/
+typedef enum {QUEUE_HEAP = 0, QUEUE_BUCKET} queue_backend_t;
+
+/**
+  Whether all cores share one ready queue or each has its own
+*/
+typedef enum {RUNQUEUE_SHARED = 0, RUNQUEUE_PER_CORE} runqueue_mode_t;
+
+/**
+  Settings a scheduler is started with, which it keeps for its lifetime.
+  scheduler_config_default() fills in the defaults.
+
+  With RUNQUEUE_PER_CORE, steal says whether a core whose queue is empty
+  takes a job from the longest queue instead of going idle, and jobs are
+  moved to even out the queues every push_interval time units (0 for
+  never). cfs_granularity is the least time a CFS job runs once placed on
+  a core, and cfs_latency the time over which every job should get to run.
+*/
+typedef struct _scheduler_config_t
+{
+  queue_backend_t queue_backend;
+  runqueue_mode_t run_queues;
+  int steal;
+  int push_interval;
+  mlfq_config_t mlfq;
+  int cfs_granularity;
+  int cfs_latency;
+} scheduler_config_t;
+
+/**
+  Per-job times the scheduler keeps a histogram of
+*/
+typedef enum {METRIC_WAITING = 0, METRIC_TURNAROUND, METRIC_RESPONSE} metric_t;
+
+/**
+  Scheduler context. Every scheduler_* function has a _r form that takes
+  one; the forms without it work on a default scheduler. Separate
+  schedulers share no state, so they can run in different threads.
+*/
+typedef struct _scheduler_t scheduler_t;
+
+void  scheduler_config_default         (scheduler_config_t *config);
+scheduler_t* scheduler_create          (int cores, scheme_t scheme, const scheduler_config_t *config);
+void  scheduler_destroy                (scheduler_t *s);
+scheduler_t* scheduler_default         ();
+
+void  scheduler_start_up_r             (scheduler_t *s, int cores, scheme_t scheme, const scheduler_config_t *config);
+void  scheduler_set_mlfq_r             (scheduler_t *s, const mlfq_config_t *config);
+void  scheduler_set_cfs_r              (scheduler_t *s, int min_granularity, int latency);
+int   scheduler_new_job_r              (scheduler_t *s, int job_number, int time, int running_time, int priority);
+int   scheduler_new_deadline_job_r     (scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline);
+int   scheduler_job_finished_r         (scheduler_t *s, int core_id, int job_number, int time);
+int   scheduler_quantum_expired_r      (scheduler_t *s, int core_id, int time);
+int   scheduler_time_slice_r           (scheduler_t *s, int core_id);
+void  scheduler_switch_cost_r          (scheduler_t *s, int core_id, int cost);
+float scheduler_average_turnaround_time_r(scheduler_t *s);
+float scheduler_average_waiting_time_r (scheduler_t *s);
+float scheduler_average_response_time_r(scheduler_t *s);
+void  scheduler_clean_up_r             (scheduler_t *s);
+void  scheduler_show_queue_r           (scheduler_t *s);
+int   scheduler_migrations_r           (scheduler_t *s);
+float scheduler_deadline_miss_rate_r   (scheduler_t *s);
+int   scheduler_lateness_percentile_r  (scheduler_t *s, double percentile);
+int   scheduler_percentile_r           (scheduler_t *s, metric_t metric, double percentile);
+
+void  scheduler_set_queue_backend      (queue_backend_t backend);
+void  scheduler_set_run_queues         (runqueue_mode_t mode, int steal, int push_interval);
+void  scheduler_set_mlfq               (const mlfq_config_t *config);
+void  scheduler_set_cfs                (int min_granularity, int latency);
+void  scheduler_start_up               (int cores, scheme_t scheme);
+int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
+int   scheduler_new_deadline_job       (int job_number, int time, int running_time, int priority, int deadline);
+int   scheduler_job_finished           (int core_id, int job_number, int time);
+int   scheduler_quantum_expired        (int core_id, int time);
+int   scheduler_time_slice             (int core_id);
+void  scheduler_switch_cost            (int core_id, int cost);
+float scheduler_average_turnaround_time();
+float scheduler_average_waiting_time   ();
+float scheduler_average_response_time  ();
+void  scheduler_clean_up               ();
+
+void  scheduler_show_queue             ();
+int   scheduler_migrations             ();
+float scheduler_deadline_miss_rate     ();
+int   scheduler_lateness_percentile    (double percentile);
+int   scheduler_percentile             (metric_t metric, double percentile);
+int  are_Any_Cores_Idle                ();
+void deincrement_Remaining_Times         (int time);
+int get_Least_Preferential_Job(void* job);
+
+int  are_Any_Cores_Idle_r              (scheduler_t *s);
+void deincrement_Remaining_Times_r     (scheduler_t *s, int time);
+int get_Least_Preferential_Job_r(scheduler_t *s, void* job);
+
+#endif /* LIBSCHEDULER_H_ */
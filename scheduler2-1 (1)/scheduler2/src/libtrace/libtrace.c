@@ -0,0 +1,315 @@
+/** @file libtrace.c
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libtrace.h"
+
+
+/*
+  Whitespace as atoi skips it.
+ */
+static int is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+/*
+  Returns the end of the line starting at p, not counting the newline.
+  memchr does the scanning, so this runs at the library's vectorized speed.
+ */
+static const char* line_end(const char *p, const char *end)
+{
+  const char* newline = memchr(p, '\n', end - p);
+  return newline ? newline : end;
+}
+
+/*
+  Parses the field [p, end) the way atoi would: leading whitespace, an
+  optional sign, then digits up to the first character that is not one.
+ */
+static int scan_int(const char *p, const char *end)
+{
+  unsigned int value = 0;
+  int negative = 0;
+
+  while(p < end && is_space(*p))
+    p++;
+  if(p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+  while(p < end && *p >= '0' && *p <= '9')
+    value = value * 10 + (*p++ - '0');
+
+  return negative ? -(int)value : (int)value;
+}
+
+
+/*
+  Sets up t to read the binary trace it has mapped.
+  Returns 0, or -1 if the header, size or checksum do not add up.
+ */
+static int open_binary(trace_t *t)
+{
+  trace_header_t header;
+  memcpy(&header, t->data, sizeof(header));
+
+  if(header.version != TRACE_VERSION || header.count > INT_MAX ||
+     (header.columns != TRACE_BASE_COLUMNS && header.columns != TRACE_COLUMNS))
+    return -1;
+  if((t->length - sizeof(header)) / (header.columns * sizeof(int32_t)) != header.count ||
+     (t->length - sizeof(header)) % (header.columns * sizeof(int32_t)) != 0)
+    return -1;
+
+  unsigned int i;
+  uint64_t hash = TRACE_CHECKSUM_SEED;
+  for(i = 0; i < header.columns; i++)
+  {
+    t->columns[i] = (const int32_t*)(t->data + sizeof(header)) + i * header.count;
+    hash = trace_checksum(hash, t->columns[i], header.count);
+  }
+  if(hash != header.checksum)
+    return -1;
+
+  t->binary = 1;
+  t->deadlines = header.columns == TRACE_COLUMNS;
+  t->count = header.count;
+  return 0;
+}
+
+
+/*
+  Counts the fields of the line [p, end) as strtok would split it.
+ */
+static int count_fields(const char *p, const char *end)
+{
+  int count = 0;
+  while(p < end)
+  {
+    while(p < end && *p == ',')
+      p++;
+    if(p == end)
+      break;
+    count++;
+    while(p < end && *p != ',')
+      p++;
+  }
+  return count;
+}
+
+
+/**
+  Opens a trace file and maps it into memory.
+
+  A CSV trace has a header line, which is skipped, and then one job per
+  line as arrival time,run time,priority, and a deadline if the header
+  names a fourth column. A binary trace (see
+  trace_header_t) is checked against its checksum here, and after that
+  costs nothing more to read than touching its pages.
+
+  @param t a pointer to an instance of the trace_t data structure
+  @param file_name the path of the trace
+  @return 0 on success
+  @return -1 if the file cannot be opened or mapped
+  @return -2 if the file is a binary trace that is truncated or corrupt
+ */
+int trace_open(trace_t *t, const char *file_name)
+{
+  struct stat st;
+
+  t->fd = open(file_name, O_RDONLY);
+  if(t->fd < 0)
+    return -1;
+
+  if(fstat(t->fd, &st) != 0)
+  {
+    close(t->fd);
+    return -1;
+  }
+
+  t->length = st.st_size;
+  t->data = 0;
+  if(t->length > 0)
+  {
+    void* data = mmap(NULL, t->length, PROT_READ, MAP_PRIVATE, t->fd, 0);
+    if(data == MAP_FAILED)
+    {
+      close(t->fd);
+      return -1;
+    }
+    madvise(data, t->length, MADV_SEQUENTIAL);
+    t->data = data;
+  }
+
+  t->binary = 0;
+  t->deadlines = 0;
+  t->count = 0;
+  t->index = 0;
+  if(t->length >= sizeof(trace_header_t) && memcmp(t->data, TRACE_MAGIC, 8) == 0)
+  {
+    if(open_binary(t) != 0)
+    {
+      trace_close(t);
+      return -2;
+    }
+    t->body = t->cursor = t->data + t->length;
+    return 0;
+  }
+
+  const char* end = t->data + t->length;
+  t->body = t->data;
+  if(t->length > 0)
+  {
+    t->body = line_end(t->data, end);
+    t->deadlines = count_fields(t->data, t->body) > TRACE_BASE_COLUMNS;
+    if(t->body < end)
+      t->body++;
+  }
+  t->cursor = t->body;
+  return 0;
+}
+
+
+/**
+  Reads the next job of the trace.
+
+  Lines are split the way strtok splits them on commas: empty fields are
+  skipped, and fields after the fourth are ignored. A job without a
+  fourth field, or in a trace without deadlines, has a deadline of 0.
+
+  @param t a pointer to an instance of the trace_t data structure
+  @param job where to store the job
+  @return 1 if a job was read
+  @return 0 at the end of the trace
+  @return -1 if the next line does not hold three fields
+ */
+int trace_next(trace_t *t, trace_job_t *job)
+{
+  const char* end = t->data + t->length;
+  int fields[TRACE_COLUMNS];
+  int count = 0;
+
+  if(t->binary)
+  {
+    if(t->index >= t->count)
+      return 0;
+    job->arrival_time = t->columns[0][t->index];
+    job->run_time = t->columns[1][t->index];
+    job->priority = t->columns[2][t->index];
+    job->deadline = t->deadlines ? t->columns[3][t->index] : 0;
+    t->index++;
+    return 1;
+  }
+
+  if(t->cursor >= end)
+    return 0;
+
+  /* The newline belongs to the last field, as it does for strtok. */
+  const char* p = t->cursor;
+  const char* eol = line_end(p, end);
+  if(eol < end)
+    eol++;
+  t->cursor = eol;
+
+  while(count < TRACE_COLUMNS)
+  {
+    while(p < eol && *p == ',')
+      p++;
+    if(p == eol)
+      break;
+
+    const char* field = p;
+    while(p < eol && *p != ',')
+      p++;
+    fields[count++] = scan_int(field, p);
+  }
+
+  if(count < TRACE_BASE_COLUMNS)
+    return -1;
+
+  job->arrival_time = fields[0];
+  job->run_time = fields[1];
+  job->priority = fields[2];
+  job->deadline = t->deadlines && count > TRACE_BASE_COLUMNS ? fields[3] : 0;
+  return 1;
+}
+
+
+/**
+  Counts the jobs left in the trace without parsing them.
+
+  @param t a pointer to an instance of the trace_t data structure
+  @return the number of jobs (lines, for CSV) from the current position
+  to the end
+ */
+int trace_count(trace_t *t)
+{
+  const char* end = t->data + t->length;
+  const char* p = t->cursor;
+  int count = 0;
+
+  if(t->binary)
+    return t->count - t->index;
+
+  while(p < end)
+  {
+    p = line_end(p, end) + 1;
+    count++;
+  }
+  return count;
+}
+
+
+/**
+  Goes back to the first job of the trace.
+
+  @param t a pointer to an instance of the trace_t data structure
+ */
+void trace_rewind(trace_t *t)
+{
+  t->cursor = t->body;
+  t->index = 0;
+}
+
+
+/**
+  Unmaps and closes the trace.
+
+  @param t a pointer to an instance of the trace_t data structure
+ */
+void trace_close(trace_t *t)
+{
+  if(t->data)
+    munmap((void*)t->data, t->length);
+  close(t->fd);
+  t->data = 0;
+  t->length = 0;
+  t->body = 0;
+  t->cursor = 0;
+}
+
+
+/**
+  Folds values into a running 64-bit FNV-1a hash, one 32-bit value at a
+  time. Start from TRACE_CHECKSUM_SEED.
+
+  @param hash the hash so far
+  @param values the values to add
+  @param count the number of values
+  @return the new hash
+ */
+uint64_t trace_checksum(uint64_t hash, const int32_t *values, size_t count)
+{
+  size_t i;
+  for(i = 0; i < count; i++)
+  {
+    hash ^= (uint32_t)values[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
@@ -0,0 +1,87 @@
+/** @file libtrace.h
+ */
+
+#ifndef LIBTRACE_H_
+#define LIBTRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+  First bytes of a binary trace
+*/
+#define TRACE_MAGIC "SCHDTRCE"
+
+#define TRACE_VERSION 1
+
+/**
+  Most columns a binary trace has: arrival time, run time, priority and
+  deadline. Traces without deadlines have only the first
+  TRACE_BASE_COLUMNS.
+*/
+#define TRACE_COLUMNS 4
+#define TRACE_BASE_COLUMNS 3
+
+#define TRACE_CHECKSUM_SEED 14695981039346656037ull
+
+/**
+  One job of a trace, as listed in the file. deadline is relative to the
+  arrival time (for rate-monotonic scheduling, the job's period), or 0 if
+  the job has none.
+*/
+typedef struct _trace_job_t
+{
+  int arrival_time;
+  int run_time;
+  int priority;
+  int deadline;
+} trace_job_t;
+
+/**
+  Header of a binary trace. It is followed by columns (TRACE_BASE_COLUMNS
+  or TRACE_COLUMNS) arrays of count int32_t each, in the order of
+  trace_job_t's fields, stored in the byte order of the machine that
+  wrote them. checksum is trace_checksum() over the arrays in turn.
+*/
+typedef struct _trace_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t columns;
+  uint64_t count;
+  uint64_t checksum;
+} trace_header_t;
+
+/**
+  Trace Reader Data Structure
+
+  Reads jobs straight out of a memory-mapped trace, one at a time, without
+  copying the file or holding more than the current job. The trace is
+  either CSV text or, if it starts with TRACE_MAGIC, binary. deadlines is
+  set if the trace has a deadline column.
+*/
+typedef struct _trace_t
+{
+  int fd;
+  const char* data;
+  size_t length;
+  const char* body;
+  const char* cursor;
+
+  int binary;
+  int deadlines;
+  const int32_t* columns[TRACE_COLUMNS];
+  int count;
+  int index;
+} trace_t;
+
+
+int  trace_open  (trace_t *t, const char *file_name);
+int  trace_next  (trace_t *t, trace_job_t *job);
+int  trace_count (trace_t *t);
+void trace_rewind(trace_t *t);
+void trace_close (trace_t *t);
+
+uint64_t trace_checksum(uint64_t hash, const int32_t *values, size_t count);
+
+#endif /* LIBTRACE_H_ */
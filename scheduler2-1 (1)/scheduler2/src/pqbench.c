@@ -0,0 +1,335 @@
+/** @file pqbench.c
+
+  Microbenchmarks for libpriqueue.
+
+  For every backend, key distribution and queue size this builds a queue
+  of that size and times offer, peek, at, remove, remove_at and poll,
+  printing one CSV row per operation with its throughput and latency
+  percentiles. Small sizes are repeated until at least BENCH_MIN_OPS offers
+  have been made so their timings are not lost in clock resolution.
+  at, remove and remove_at may walk the whole queue, so they get a fixed
+  number of calls per case, fewer still once that would mean more than
+  BENCH_LINEAR_WORK element visits.
+
+  Usage: pqbench [-n <max size>] [-l <max list size>] [-k <linear ops>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libpriqueue/libpriqueue.h"
+
+#define BENCH_MIN_OPS 1000000
+#define BENCH_SAMPLES (1 << 18)
+#define BENCH_LINEAR_WORK 20000000
+
+typedef enum {SORTED = 0, REVERSE, RANDOM, DUPLICATES} distribution_t;
+
+static const char *distribution_names[] = { "sorted", "reverse", "random", "duplicates" };
+
+typedef struct _bench_backend_t
+{
+  const char *name;
+  priqueue_backend_t backend;
+} bench_backend_t;
+
+static const bench_backend_t backends[] = {
+  { "list", PRIQUEUE_LIST },
+  { "heap", PRIQUEUE_HEAP },
+  { "indexed_heap", PRIQUEUE_INDEXED_HEAP },
+  { "bucket", PRIQUEUE_BUCKET },
+};
+
+/* Keys are shifted down so a case uses about as many buckets as elements. */
+static int bucket_shift;
+
+/**
+  Timings gathered for one operation. Only every stride'th call is timed
+  individually; the rest just run, so the clock does not dominate the
+  throughput figure for cheap operations.
+*/
+typedef struct _bench_stats_t
+{
+  const char *operation;
+  uint32_t *samples;
+  int count;
+  long long ops;
+  long long stride;
+  double seconds;
+} bench_stats_t;
+
+
+static inline uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Runs expr as call number `call` of stats, timing it if it is sampled. */
+#define BENCH_CALL(stats, call, expr)                                         \
+  do {                                                                        \
+    if((call) % (stats)->stride == 0 && (stats)->count < BENCH_SAMPLES)       \
+    {                                                                         \
+      uint64_t start_ = now_ns();                                             \
+      expr;                                                                   \
+      (stats)->samples[(stats)->count++] = (uint32_t)(now_ns() - start_);     \
+    }                                                                         \
+    else                                                                      \
+    {                                                                         \
+      expr;                                                                   \
+    }                                                                         \
+  } while(0)
+
+static int compare_int(const void *a, const void *b)
+{
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int key_int(const void *a)
+{
+  return *(const int *)a >> bucket_shift;
+}
+
+static void stats_init(bench_stats_t *stats, const char *operation, long long expected_ops)
+{
+  stats->operation = operation;
+  stats->count = 0;
+  stats->ops = 0;
+  stats->seconds = 0.0;
+  stats->stride = expected_ops / BENCH_SAMPLES + 1;
+}
+
+static void stats_print(bench_stats_t *stats, const char *backend, const char *distribution, int size)
+{
+  if(stats->ops == 0)
+    return;
+
+  qsort(stats->samples, stats->count, sizeof(uint32_t), compare_u32);
+  uint32_t p50 = stats->samples[(int)(stats->count * 0.50)];
+  uint32_t p90 = stats->samples[(int)(stats->count * 0.90)];
+  uint32_t p99 = stats->samples[(int)(stats->count * 0.99)];
+  uint32_t max = stats->samples[stats->count - 1];
+
+  printf("%s,%s,%d,%s,%lld,%.1f,%.3f,%u,%u,%u,%u\n",
+         backend, distribution, size, stats->operation, stats->ops,
+         stats->seconds * 1e9 / stats->ops, stats->ops / stats->seconds / 1e6,
+         p50, p90, p99, max);
+  fflush(stdout);
+}
+
+static void fill_keys(int *keys, int size, distribution_t distribution)
+{
+  int i;
+  for(i = 0; i < size; i++)
+  {
+    switch(distribution)
+    {
+      case SORTED:     keys[i] = i;             break;
+      case REVERSE:    keys[i] = size - i;      break;
+      case RANDOM:     keys[i] = rand();        break;
+      case DUPLICATES: keys[i] = rand() % 16;   break;
+    }
+  }
+}
+
+/**
+  Benchmarks one backend on one key distribution at one size.
+ */
+static void bench_case(const bench_backend_t *backend, distribution_t distribution, int size,
+                       int linear_ops, int *keys, uint32_t *samples)
+{
+  enum {OFFER = 0, PEEK, AT, REMOVE, REMOVE_AT, POLL, NUM_OPS};
+  static const char *names[] = { "offer", "peek", "at", "remove", "remove_at", "poll" };
+
+  int rounds = BENCH_MIN_OPS / size + 1;
+  int linear_total = BENCH_LINEAR_WORK / size;
+  if(linear_total < 4)
+    linear_total = 4;
+  if(linear_total > linear_ops)
+    linear_total = linear_ops;
+  long long expected[NUM_OPS];
+  expected[OFFER] = expected[PEEK] = expected[POLL] = (long long)rounds * size;
+  expected[AT] = expected[REMOVE] = expected[REMOVE_AT] = linear_total;
+
+  bench_stats_t stats[NUM_OPS];
+  int op, round, i;
+
+  for(op = 0; op < NUM_OPS; op++)
+  {
+    /* Each operation records into its own BENCH_SAMPLES slice of samples. */
+    stats[op].samples = samples + (size_t)op * BENCH_SAMPLES;
+    stats_init(&stats[op], names[op], expected[op]);
+  }
+
+  fill_keys(keys, size, distribution);
+
+  int max_key = 0;
+  for(i = 0; i < size; i++)
+    if(keys[i] > max_key)
+      max_key = keys[i];
+  for(bucket_shift = 0; (max_key >> bucket_shift) > size; bucket_shift++);
+
+  for(round = 0; round < rounds; round++)
+  {
+    priqueue_t q;
+    uint64_t start;
+    bench_stats_t *s;
+    int linear = linear_total / rounds + (round < linear_total % rounds);
+    if(linear > size)
+      linear = size;
+    if(backend->backend == PRIQUEUE_BUCKET)
+      priqueue_init_bucket(&q, compare_int, key_int);
+    else
+      priqueue_init_backend(&q, compare_int, backend->backend);
+
+    s = &stats[OFFER];
+    start = now_ns();
+    for(i = 0; i < size; i++)
+      BENCH_CALL(s, s->ops + i, priqueue_offer(&q, &keys[i]));
+    s->seconds += (now_ns() - start) / 1e9;
+    s->ops += size;
+
+    s = &stats[PEEK];
+    start = now_ns();
+    for(i = 0; i < size; i++)
+    {
+      void * volatile head;
+      BENCH_CALL(s, s->ops + i, head = priqueue_peek(&q));
+      (void)head;
+    }
+    s->seconds += (now_ns() - start) / 1e9;
+    s->ops += size;
+
+    /* Most rounds of a small size make no linear calls; timing them would
+       only add clock overhead. */
+    s = &stats[AT];
+    if(linear > 0)
+    {
+      start = now_ns();
+      for(i = 0; i < linear; i++)
+      {
+        void * volatile elem;
+        int index = rand() % size;
+        BENCH_CALL(s, s->ops + i, elem = priqueue_at(&q, index));
+        (void)elem;
+      }
+      s->seconds += (now_ns() - start) / 1e9;
+      s->ops += linear;
+    }
+
+    /* Removed elements are offered back, untimed, to keep the size fixed. */
+    s = &stats[REMOVE];
+    for(i = 0; i < linear; i++)
+    {
+      int *key = &keys[rand() % size];
+      start = now_ns();
+      BENCH_CALL(s, s->ops + i, priqueue_remove(&q, key));
+      s->seconds += (now_ns() - start) / 1e9;
+      priqueue_offer(&q, key);
+    }
+    s->ops += linear;
+
+    s = &stats[REMOVE_AT];
+    for(i = 0; i < linear; i++)
+    {
+      void *elem;
+      int index = rand() % size;
+      start = now_ns();
+      BENCH_CALL(s, s->ops + i, elem = priqueue_remove_at(&q, index));
+      s->seconds += (now_ns() - start) / 1e9;
+      priqueue_offer(&q, elem);
+    }
+    s->ops += linear;
+
+    s = &stats[POLL];
+    start = now_ns();
+    for(i = 0; i < size; i++)
+      BENCH_CALL(s, s->ops + i, priqueue_poll(&q));
+    s->seconds += (now_ns() - start) / 1e9;
+    s->ops += size;
+
+    priqueue_destroy(&q);
+  }
+
+  for(op = 0; op < NUM_OPS; op++)
+    stats_print(&stats[op], backend->name, distribution_names[distribution], size);
+}
+
+static void print_usage(char *program_name)
+{
+  fprintf(stderr, "Usage: %s [-n <max size>] [-l <max list size>] [-k <linear ops>]\n", program_name);
+  fprintf(stderr, "  -n  largest queue size, sizes run in powers of ten from 10 (default 10000000)\n");
+  fprintf(stderr, "  -l  largest size the O(n) list backend is run at (default 10000)\n");
+  fprintf(stderr, "  -k  calls per case to at, remove and remove_at (default 1000)\n");
+}
+
+int main(int argc, char **argv)
+{
+  int max_size = 10000000, max_list_size = 10000, linear_ops = 1000;
+  int c;
+
+  while((c = getopt(argc, argv, "n:l:k:")) != -1)
+  {
+    switch(c)
+    {
+      case 'n': max_size = atoi(optarg);      break;
+      case 'l': max_list_size = atoi(optarg); break;
+      case 'k': linear_ops = atoi(optarg);    break;
+      default:
+        print_usage(argv[0]);
+        return 1;
+    }
+  }
+  if(max_size < 10 || linear_ops < 1)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  int *keys = malloc((size_t)max_size * sizeof(int));
+  uint32_t *samples = malloc((size_t)6 * BENCH_SAMPLES * sizeof(uint32_t));
+  if(keys == NULL || samples == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    return 2;
+  }
+
+  srand(678);
+  printf("backend,distribution,size,operation,ops,ns_per_op,mops,p50_ns,p90_ns,p99_ns,max_ns\n");
+
+  unsigned int b;
+  int size;
+  distribution_t d;
+  for(b = 0; b < sizeof(backends) / sizeof(backends[0]); b++)
+  {
+    for(d = SORTED; d <= DUPLICATES; d++)
+    {
+      for(size = 10; size <= max_size; size *= 10)
+      {
+        if(backends[b].backend == PRIQUEUE_LIST && size > max_list_size)
+          break;
+        bench_case(&backends[b], d, size, linear_ops, keys, samples);
+        if(size > max_size / 10)
+          break;
+      }
+    }
+  }
+
+  free(samples);
+  free(keys);
+  return 0;
+}
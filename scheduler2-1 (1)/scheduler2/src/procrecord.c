@@ -0,0 +1,342 @@
+/** @file procrecord.c
+
+  Records the processes running on this machine as a CSV trace for the
+  simulator, so schemes can be compared on real behavior. Replay the trace
+  at full speed with "simulator -e -q", or convert it with csv2trace.
+
+  Every interval it reads /proc/<pid>/stat for every process, in the field
+  layout lab11's procstat reads, keeping each process's start time, CPU
+  time (utime + stime) and nice value. Each process that used the CPU
+  while recording becomes a job:
+  - its arrival time is when it started, after the first sample, or 0 if
+    it was already running then;
+  - its run time is the CPU time it used from then, or from its start, up
+    to the last sample it was seen in;
+  - its priority is its nice value, which PRI and PPRI order and CFS
+    weights the way Linux does.
+  Times are in clock ticks (sysconf(_SC_CLK_TCK) a second), and jobs are
+  listed by arrival time, so the trace can be streamed with -S too.
+
+  libscheduler expects every job to arrive at a different time, but every
+  process already running arrives at 0 and processes often start in the
+  same tick. Jobs that tie are spread out in order of their start time
+  (then pid), each arriving one tick after the job before it.
+
+  CPU time a process uses after the last sample it was seen in is lost,
+  so shorter intervals trace short-lived processes better.
+
+  Usage: procrecord [-d <seconds>] [-i <milliseconds>] <output csv>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/**
+  One process seen while recording. A pid that turns up again with
+  another start time is another process, and gets another record.
+*/
+typedef struct _proc_record_t
+{
+  int pid;
+  unsigned long long start_time;
+  long long first_cpu;
+  long long last_cpu;
+  int nice;
+  int arrival_time;
+} proc_record_t;
+
+/**
+  The fields of /proc/<pid>/stat a recording uses.
+*/
+typedef struct _proc_stat_t
+{
+  int pid;
+  long long utime, stime;
+  int nice;
+  unsigned long long start_time;
+} proc_stat_t;
+
+typedef struct _recorder_t
+{
+  proc_record_t *records;
+  int num_records, capacity;
+  int *latest;		// index in records of the last process seen with each pid, or -1
+  int max_pid;
+  unsigned long long origin;	// clock ticks since boot at the first sample
+  int first_sample;
+} recorder_t;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop_recording(int signum)
+{
+  (void)signum;
+  stopping = 1;
+}
+
+/**
+  Reads /proc/<pid>/stat. The command name is skipped up to its last ')',
+  as it can hold spaces and parentheses itself.
+
+  @return 0 on success, or -1 if the process is gone or the file is not
+    understood
+ */
+static int read_stat(const char *pid, proc_stat_t *stat)
+{
+  char path[64], line[1024];
+  FILE *input;
+
+  snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+  if((input = fopen(path, "r")) == NULL)
+    return -1;
+  if(fgets(line, sizeof(line), input) == NULL)
+  {
+    fclose(input);
+    return -1;
+  }
+  fclose(input);
+
+  char *rest = strrchr(line, ')');
+  if(rest == NULL || sscanf(line, "%d", &stat->pid) != 1)
+    return -1;
+
+  /* state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt
+     utime stime cutime cstime priority nice num_threads itrealvalue starttime */
+  if(sscanf(rest + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lld %lld %*d %*d %*d %d %*d %*d %llu",
+            &stat->utime, &stat->stime, &stat->nice, &stat->start_time) != 4)
+    return -1;
+  return 0;
+}
+
+static unsigned long long ticks_since_boot(long ticks_per_second)
+{
+  FILE *uptime = fopen("/proc/uptime", "r");
+  double seconds = 0.0;
+
+  if(uptime == NULL || fscanf(uptime, "%lf", &seconds) != 1)
+  {
+    fprintf(stderr, "Unable to read /proc/uptime.\n");
+    exit(2);
+  }
+  fclose(uptime);
+  return (unsigned long long)(seconds * ticks_per_second);
+}
+
+static int max_pid()
+{
+  FILE *input = fopen("/proc/sys/kernel/pid_max", "r");
+  int value = 0;
+
+  if(input != NULL)
+  {
+    if(fscanf(input, "%d", &value) != 1)
+      value = 0;
+    fclose(input);
+  }
+  return value > 0 ? value : 4194304;
+}
+
+static void recorder_init(recorder_t *r)
+{
+  r->records = NULL;
+  r->num_records = 0;
+  r->capacity = 0;
+  r->max_pid = max_pid();
+  r->latest = malloc((size_t)(r->max_pid + 1) * sizeof(int));
+  if(r->latest == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    exit(2);
+  }
+  memset(r->latest, -1, (size_t)(r->max_pid + 1) * sizeof(int));
+  r->origin = 0;
+  r->first_sample = 1;
+}
+
+static void recorder_destroy(recorder_t *r)
+{
+  free(r->records);
+  free(r->latest);
+}
+
+static proc_record_t *recorder_add(recorder_t *r, const proc_stat_t *stat)
+{
+  if(r->num_records == r->capacity)
+  {
+    r->capacity = r->capacity ? r->capacity * 2 : 256;
+    r->records = realloc(r->records, r->capacity * sizeof(proc_record_t));
+    if(r->records == NULL)
+    {
+      fprintf(stderr, "Out of memory.\n");
+      exit(2);
+    }
+  }
+
+  proc_record_t *record = &r->records[r->num_records];
+  record->pid = stat->pid;
+  record->start_time = stat->start_time;
+  if(r->first_sample)
+  {
+    record->first_cpu = stat->utime + stat->stime;
+    record->arrival_time = 0;
+  }
+  else
+  {
+    record->first_cpu = 0;
+    record->arrival_time = stat->start_time > r->origin ? (int)(stat->start_time - r->origin) : 0;
+  }
+  r->latest[stat->pid] = r->num_records++;
+  return record;
+}
+
+/**
+  Takes one sample of every process.
+ */
+static void recorder_sample(recorder_t *r, long ticks_per_second)
+{
+  DIR *proc = opendir("/proc");
+  struct dirent *entry;
+  proc_stat_t stat;
+  int self = getpid();
+
+  if(proc == NULL)
+  {
+    fprintf(stderr, "Unable to open /proc.\n");
+    exit(2);
+  }
+
+  if(r->first_sample)
+    r->origin = ticks_since_boot(ticks_per_second);
+
+  while((entry = readdir(proc)) != NULL)
+  {
+    if(!isdigit((unsigned char)entry->d_name[0]) || read_stat(entry->d_name, &stat) != 0)
+      continue;
+    if(stat.pid == self || stat.pid < 0 || stat.pid > r->max_pid)
+      continue;
+
+    int index = r->latest[stat.pid];
+    proc_record_t *record;
+    if(index != -1 && r->records[index].start_time == stat.start_time)
+      record = &r->records[index];
+    else
+      record = recorder_add(r, &stat);
+
+    record->last_cpu = stat.utime + stat.stime;
+    record->nice = stat.nice;
+  }
+
+  closedir(proc);
+  r->first_sample = 0;
+}
+
+static int compare_arrival(const void *a, const void *b)
+{
+  const proc_record_t *x = a, *y = b;
+  if(x->arrival_time != y->arrival_time)
+    return (x->arrival_time > y->arrival_time) - (x->arrival_time < y->arrival_time);
+  if(x->start_time != y->start_time)
+    return (x->start_time > y->start_time) - (x->start_time < y->start_time);
+  return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+/**
+  Writes the processes that used the CPU as a CSV trace, with strictly
+  increasing arrival times.
+
+  @return the number of jobs written, or -1 if the output cannot be written
+ */
+static int write_trace(recorder_t *r, FILE *out)
+{
+  int i, jobs = 0, last_arrival = -1;
+
+  qsort(r->records, r->num_records, sizeof(proc_record_t), compare_arrival);
+  fprintf(out, "\"Arrival time\",\"Run time\",\"Priority\"\n");
+  for(i = 0; i < r->num_records; i++)
+  {
+    proc_record_t *record = &r->records[i];
+    long long run_time = record->last_cpu - record->first_cpu;
+    if(run_time <= 0)
+      continue;
+
+    int arrival_time = record->arrival_time > last_arrival ? record->arrival_time : last_arrival + 1;
+    last_arrival = arrival_time;
+    fprintf(out, "%d,%lld,%d\n", arrival_time, run_time, record->nice);
+    jobs++;
+  }
+  return ferror(out) ? -1 : jobs;
+}
+
+static void print_usage(char *program_name)
+{
+  fprintf(stderr, "Usage: %s [-d <seconds>] [-i <milliseconds>] <output csv>\n", program_name);
+  fprintf(stderr, "  -d  how long to record for (default 10); Ctrl-C stops early\n");
+  fprintf(stderr, "  -i  time between samples of /proc (default 100)\n");
+}
+
+int main(int argc, char **argv)
+{
+  double duration = 10.0;
+  int interval = 100, c;
+  long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+  while((c = getopt(argc, argv, "d:i:")) != -1)
+  {
+    switch(c)
+    {
+      case 'd': duration = atof(optarg); break;
+      case 'i': interval = atoi(optarg); break;
+      default:
+        print_usage(argv[0]);
+        return 1;
+    }
+  }
+  if(optind != argc - 1 || duration <= 0.0 || interval <= 0)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  FILE *out = fopen(argv[optind], "w");
+  if(out == NULL)
+  {
+    fprintf(stderr, "Unable to open file \"%s\".\n", argv[optind]);
+    return 2;
+  }
+
+  signal(SIGINT, stop_recording);
+  signal(SIGTERM, stop_recording);
+
+  recorder_t recorder;
+  recorder_init(&recorder);
+
+  struct timespec pause = { interval / 1000, (interval % 1000) * 1000000L };
+  int samples = (int)(duration * 1000 / interval) + 1, i;
+  for(i = 0; i < samples && !stopping; i++)
+  {
+    if(i > 0)
+      nanosleep(&pause, NULL);
+    recorder_sample(&recorder, ticks_per_second);
+  }
+
+  int jobs = write_trace(&recorder, out);
+  if(fclose(out) != 0)
+    jobs = -1;
+  recorder_destroy(&recorder);
+
+  if(jobs < 0)
+  {
+    fprintf(stderr, "Unable to write file \"%s\".\n", argv[optind]);
+    remove(argv[optind]);
+    return 2;
+  }
+
+  fprintf(stderr, "Recorded %d job(s) over %d sample(s), in units of 1/%ld s.\n", jobs, i, ticks_per_second);
+  return 0;
+}
@@ -1,74 +1,539 @@
-/** @file queuetest.c
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-
-#include "libpriqueue/libpriqueue.h"
-
-int compare1(const void * a, const void * b)
-{
- 	return ( *(int*)a - *(int*)b );
-}
-
-int compare2(const void * a, const void * b)
-{
-	return ( *(int*)b - *(int*)a );
-}
-
-int main()
-{
-	priqueue_t q, q2;
-
-	priqueue_init(&q, compare1);
-	priqueue_init(&q2, compare2);
-
-	/* Pupulate some data... */
-	int *values = malloc(100 * sizeof(int));
-
-	int i;
-	for (i = 0; i < 100; i++)
-		values[i] = i;
-
-	/* Add 5 values, 3 unique. */
-	priqueue_offer(&q, &values[12]);
-	priqueue_offer(&q, &values[13]);
-	priqueue_offer(&q, &values[14]);
-	priqueue_offer(&q, &values[12]);
-	priqueue_offer(&q, &values[12]);
-	printf("Total elements: %d (expected 5).\n", priqueue_size(&q));
-
-	int val = *((int *)priqueue_poll(&q));
-	printf("Top element: %d (expected 12).\n", val);
-	printf("Total elements: %d (expected 4).\n", priqueue_size(&q));
-
-	int vals_removed = priqueue_remove(&q, &values[12]);
-	printf("Elements removed: %d (expected 2).\n", vals_removed);
-	printf("Total elements: %d (expected 2).\n", priqueue_size(&q));
-
-	priqueue_offer(&q, &values[10]);
-	priqueue_offer(&q, &values[30]);
-	priqueue_offer(&q, &values[20]);
-
-	priqueue_offer(&q2, &values[10]);
-	priqueue_offer(&q2, &values[30]);
-	priqueue_offer(&q2, &values[20]);
-
-
-	printf("Elements in order queue (expected 10 13 14 20 30): ");
-	for (i = 0; i < priqueue_size(&q); i++)
-		printf("%d ", *((int *)priqueue_at(&q, i)) );
-	printf("\n");
-
-	printf("Elements in reverse order queue (expected 30 20 10): ");
-	for (i = 0; i < priqueue_size(&q2); i++)
-		printf("%d ", *((int *)priqueue_at(&q2, i)) );
-	printf("\n");
-
-	priqueue_destroy(&q2);
-	priqueue_destroy(&q);
-
-	free(values);
-
-	return 0;
-}
+/** @file queuetest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libpriqueue/libpriqueue.h"
+#include "libpriqueue/libcpriqueue.h"
+
+int compare1(const void * a, const void * b)
+{
+ 	return ( *(int*)a - *(int*)b );
+}
+
+int compare2(const void * a, const void * b)
+{
+	return ( *(int*)b - *(int*)a );
+}
+
+int compare_tens(const void * a, const void * b)
+{
+	return ( *(int*)a / 10 - *(int*)b / 10 );
+}
+
+int key_twenties(const void * a)
+{
+	return ( *(int*)a / 20 );
+}
+
+int key_value(const void * a)
+{
+	return ( *(int*)a );
+}
+
+typedef struct _linked_int_t
+{
+	int value;
+	priqueue_link_t link;
+} linked_int_t;
+
+int compare_linked(const void * a, const void * b)
+{
+	return ( ((linked_int_t*)a)->value - ((linked_int_t*)b)->value );
+}
+
+/*
+ * Concurrent throughput benchmark, run with `./queuetest bench`.
+ *
+ * Every thread alternates offers and polls against a queue prefilled with
+ * BENCH_PREFILL elements, sharing BENCH_OPS operations between them. New
+ * keys land a random distance past the last key polled, the way a
+ * simulation's future events do.
+ */
+#define BENCH_OPS 400000
+#define BENCH_PREFILL 1024
+#define BENCH_MAX_THREADS 64
+
+typedef struct _locked_queue_t
+{
+	pthread_mutex_t lock;
+	priqueue_t queue;
+} locked_queue_t;
+
+typedef struct _bench_target_t
+{
+	const char *name;
+	int (*offer)(void *q, void *ptr);
+	void *(*poll)(void *q);
+	void *q;
+} bench_target_t;
+
+typedef struct _bench_thread_t
+{
+	bench_target_t *target;
+	int *keys;
+	int ops;
+	unsigned int seed;
+} bench_thread_t;
+
+int locked_offer(void *q, void *ptr)
+{
+	locked_queue_t *lq = q;
+	pthread_mutex_lock(&lq->lock);
+	int index = priqueue_offer(&lq->queue, ptr);
+	pthread_mutex_unlock(&lq->lock);
+	return index;
+}
+
+void *locked_poll(void *q)
+{
+	locked_queue_t *lq = q;
+	pthread_mutex_lock(&lq->lock);
+	void *ptr = priqueue_poll(&lq->queue);
+	pthread_mutex_unlock(&lq->lock);
+	return ptr;
+}
+
+int sharded_offer(void *q, void *ptr)
+{
+	return cpriqueue_offer(q, ptr);
+}
+
+void *sharded_poll(void *q)
+{
+	return cpriqueue_poll(q);
+}
+
+void *bench_thread(void *arg)
+{
+	bench_thread_t *t = arg;
+	int i, last = 0;
+	for (i = 0; i < t->ops; i++)
+	{
+		if (i & 1)
+		{
+			int *key = t->target->poll(t->target->q);
+			if (key != NULL)
+				last = *key;
+		}
+		else
+		{
+			t->keys[i / 2] = last + rand_r(&t->seed) % BENCH_PREFILL;
+			t->target->offer(t->target->q, &t->keys[i / 2]);
+		}
+	}
+	return NULL;
+}
+
+double bench_run(bench_target_t *target, int threads, int *values)
+{
+	pthread_t tids[BENCH_MAX_THREADS];
+	bench_thread_t args[BENCH_MAX_THREADS];
+	struct timespec start, end;
+	int i;
+
+	for (i = 0; i < BENCH_PREFILL; i++)
+		target->offer(target->q, &values[i]);
+
+	for (i = 0; i < threads; i++)
+	{
+		args[i].target = target;
+		args[i].keys = malloc((BENCH_OPS / threads / 2 + 1) * sizeof(int));
+		args[i].ops = BENCH_OPS / threads;
+		args[i].seed = i + 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	while (target->poll(target->q) != NULL)
+		;
+	for (i = 0; i < threads; i++)
+		free(args[i].keys);
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	return (BENCH_OPS / threads) * threads / seconds / 1e6;
+}
+
+int bench()
+{
+	int *values = malloc(BENCH_PREFILL * sizeof(int));
+	int i, threads;
+	for (i = 0; i < BENCH_PREFILL; i++)
+		values[i] = rand() % BENCH_PREFILL;
+
+	locked_queue_t list, heap;
+	cpriqueue_t sharded;
+
+	bench_target_t targets[] = {
+		{ "mutex_list", locked_offer, locked_poll, &list },
+		{ "mutex_heap", locked_offer, locked_poll, &heap },
+		{ "sharded", sharded_offer, sharded_poll, &sharded },
+	};
+	int num_targets = sizeof(targets) / sizeof(targets[0]);
+
+	printf("threads");
+	for (i = 0; i < num_targets; i++)
+		printf(",%s_mops", targets[i].name);
+	printf("\n");
+
+	for (threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2)
+	{
+		pthread_mutex_init(&list.lock, NULL);
+		priqueue_init_backend(&list.queue, compare1, PRIQUEUE_LIST);
+		pthread_mutex_init(&heap.lock, NULL);
+		priqueue_init_backend(&heap.queue, compare1, PRIQUEUE_HEAP);
+		cpriqueue_init(&sharded, compare1, 2 * threads);
+
+		printf("%d", threads);
+		for (i = 0; i < num_targets; i++)
+			printf(",%.3f", bench_run(&targets[i], threads, values));
+		printf("\n");
+
+		priqueue_destroy(&list.queue);
+		pthread_mutex_destroy(&list.lock);
+		priqueue_destroy(&heap.queue);
+		pthread_mutex_destroy(&heap.lock);
+		cpriqueue_destroy(&sharded);
+	}
+
+	free(values);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "bench") == 0)
+		return bench();
+
+	priqueue_t q, q2;
+
+	priqueue_init(&q, compare1);
+	priqueue_init(&q2, compare2);
+
+	/* Pupulate some data... */
+	int *values = malloc(100 * sizeof(int));
+
+	int i;
+	for (i = 0; i < 100; i++)
+		values[i] = i;
+
+	/* Add 5 values, 3 unique. */
+	priqueue_offer(&q, &values[12]);
+	priqueue_offer(&q, &values[13]);
+	priqueue_offer(&q, &values[14]);
+	priqueue_offer(&q, &values[12]);
+	priqueue_offer(&q, &values[12]);
+	printf("Total elements: %d (expected 5).\n", priqueue_size(&q));
+
+	int val = *((int *)priqueue_poll(&q));
+	printf("Top element: %d (expected 12).\n", val);
+	printf("Total elements: %d (expected 4).\n", priqueue_size(&q));
+
+	int vals_removed = priqueue_remove(&q, &values[12]);
+	printf("Elements removed: %d (expected 2).\n", vals_removed);
+	printf("Total elements: %d (expected 2).\n", priqueue_size(&q));
+
+	priqueue_offer(&q, &values[10]);
+	priqueue_offer(&q, &values[30]);
+	priqueue_offer(&q, &values[20]);
+
+	priqueue_offer(&q2, &values[10]);
+	priqueue_offer(&q2, &values[30]);
+	priqueue_offer(&q2, &values[20]);
+
+
+	printf("Elements in order queue (expected 10 13 14 20 30): ");
+	for (i = 0; i < priqueue_size(&q); i++)
+		printf("%d ", *((int *)priqueue_at(&q, i)) );
+	printf("\n");
+
+	printf("Elements in reverse order queue (expected 30 20 10): ");
+	for (i = 0; i < priqueue_size(&q2); i++)
+		printf("%d ", *((int *)priqueue_at(&q2, i)) );
+	printf("\n");
+
+	printf("Element at 3 after offering 11 (expected 14): ");
+	priqueue_offer(&q, &values[11]);
+	printf("%d\n", *((int *)priqueue_at(&q, 3)) );
+
+	priqueue_iter_t it;
+	int *elem;
+	printf("Elements walked by iterator (expected 10 11 13 14 20 30): ");
+	priqueue_iter_begin(&q, &it);
+	while ((elem = priqueue_iter_next(&it)) != NULL)
+		printf("%d ", *elem);
+	printf("\n");
+
+	void *snapshot[4];
+	int copied = priqueue_snapshot(&q2, snapshot, 4);
+	printf("Snapshot of reverse order queue (expected 3: 30 20 10): %d:", copied);
+	for (i = 0; i < copied; i++)
+		printf(" %d", *((int *)snapshot[i]) );
+	printf("\n");
+
+	priqueue_destroy(&q2);
+	priqueue_destroy(&q);
+
+	/* Same checks against the heap backend. */
+	priqueue_t h;
+	priqueue_init_backend(&h, compare1, PRIQUEUE_HEAP);
+
+	priqueue_offer(&h, &values[12]);
+	priqueue_offer(&h, &values[13]);
+	priqueue_offer(&h, &values[14]);
+	priqueue_offer(&h, &values[12]);
+	priqueue_offer(&h, &values[12]);
+	printf("Heap total elements: %d (expected 5).\n", priqueue_size(&h));
+
+	val = *((int *)priqueue_poll(&h));
+	printf("Heap top element: %d (expected 12).\n", val);
+
+	vals_removed = priqueue_remove(&h, &values[12]);
+	printf("Heap elements removed: %d (expected 2).\n", vals_removed);
+
+	priqueue_offer(&h, &values[10]);
+	priqueue_offer(&h, &values[30]);
+	priqueue_offer(&h, &values[20]);
+
+	printf("Elements in order heap (expected 10 13 14 20 30): ");
+	for (i = 0; i < priqueue_size(&h); i++)
+		printf("%d ", *((int *)priqueue_at(&h, i)) );
+	printf("\n");
+
+	printf("Heap elements walked by iterator (expected 10 13 14 20 30): ");
+	priqueue_iter_begin(&h, &it);
+	while ((elem = priqueue_iter_next(&it)) != NULL)
+		printf("%d ", *elem);
+	printf("\n");
+
+	val = *((int *)priqueue_remove_at(&h, 1));
+	printf("Heap element removed at 1: %d (expected 13).\n", val);
+
+	printf("Heap drained (expected 10 14 20 30): ");
+	while (priqueue_size(&h) > 0)
+		printf("%d ", *((int *)priqueue_poll(&h)) );
+	printf("\n");
+
+	/* Elements the comparer considers equal come back in offer order. */
+	priqueue_destroy(&h);
+	priqueue_init_backend(&q, compare_tens, PRIQUEUE_LIST);
+	for (i = 0; i < 100; i += 7)
+		priqueue_offer(&q, &values[(i * 37) % 100]);
+
+	priqueue_init_backend(&h, compare_tens, PRIQUEUE_HEAP);
+	for (i = 0; i < 100; i += 7)
+		priqueue_offer(&h, &values[(i * 37) % 100]);
+
+	int stable = 1;
+	while (priqueue_size(&q) > 0)
+		if (priqueue_poll(&q) != priqueue_poll(&h))
+			stable = 0;
+	printf("List and heap agree on tie order: %d (expected 1).\n", stable);
+
+	priqueue_destroy(&h);
+	priqueue_destroy(&q);
+
+	/* Handles let an element be reprioritized or removed in place. */
+	int keys[5] = { 40, 10, 30, 20, 50 };
+	int handles[5];
+
+	priqueue_init_backend(&h, compare1, PRIQUEUE_INDEXED_HEAP);
+	for (i = 0; i < 5; i++)
+		handles[i] = priqueue_offer(&h, &keys[i]);
+
+	keys[4] = 5;
+	priqueue_update_handle(&h, handles[4]);
+	printf("Top after decrease-key: %d (expected 5).\n", *((int *)priqueue_peek(&h)));
+
+	keys[1] = 45;
+	priqueue_update_handle(&h, handles[1]);
+	val = *((int *)priqueue_remove_handle(&h, handles[2]));
+	printf("Removed by handle: %d (expected 30).\n", val);
+	printf("Stale handle removes: %d (expected 1).\n", priqueue_remove_handle(&h, handles[2]) == NULL);
+
+	printf("Indexed heap drained (expected 5 20 40 45): ");
+	while (priqueue_size(&h) > 0)
+		printf("%d ", *((int *)priqueue_poll(&h)) );
+	printf("\n");
+
+	priqueue_destroy(&h);
+
+	/* List nodes are recycled, and can be carved from a caller's arena. */
+	Node arena[8];
+	unsigned long hits, misses;
+
+	priqueue_init(&q, compare1);
+	priqueue_set_arena(&q, arena, sizeof(arena));
+	for (i = 0; i < 8; i++)
+		priqueue_offer(&q, &values[i]);
+	while (priqueue_size(&q) > 0)
+		priqueue_poll(&q);
+	for (i = 0; i < 8; i++)
+		priqueue_offer(&q, &values[i]);
+
+	priqueue_pool_stats(&q, &hits, &misses);
+	printf("Pool hits: %lu, misses: %lu (expected 8, 8).\n", hits, misses);
+	printf("Head node is in the arena: %d (expected 1).\n", q.root >= arena && q.root < arena + 8);
+
+	priqueue_offer(&q, &values[8]);
+	priqueue_pool_stats(&q, &hits, &misses);
+	printf("Pool misses once the arena is full: %lu (expected 9).\n", misses);
+
+	priqueue_destroy(&q);
+
+	/* Bulk offers match one-at-a-time offers, ties included. */
+	void *batch[100];
+	void *drained[100];
+	for (i = 0; i < 100; i++)
+		batch[i] = &values[(i * 37) % 100];
+
+	priqueue_init_backend(&q, compare_tens, PRIQUEUE_LIST);
+	priqueue_init_backend(&h, compare_tens, PRIQUEUE_HEAP);
+	priqueue_offer(&q, &values[55]);
+	priqueue_offer(&h, &values[55]);
+	priqueue_offer_bulk(&q, batch, 100);
+	priqueue_offer_bulk(&h, batch, 100);
+	printf("Bulk offered sizes: %d %d (expected 101 101).\n", priqueue_size(&q), priqueue_size(&h));
+
+	int polled = priqueue_poll_bulk(&h, drained, 20);
+	stable = polled == 20;
+	for (i = 0; i < polled; i++)
+		if (priqueue_poll(&q) != drained[i])
+			stable = 0;
+	polled = priqueue_poll_bulk(&h, drained, 1000);
+	printf("Bulk polled remainder: %d (expected 81).\n", polled);
+	for (i = 0; i < polled; i++)
+		if (priqueue_poll(&q) != drained[i])
+			stable = 0;
+	printf("Bulk list and heap agree: %d (expected 1).\n", stable && priqueue_size(&q) == 0);
+
+	priqueue_destroy(&h);
+	priqueue_destroy(&q);
+
+	/* The bucket queue keeps comparer order within and across buckets. */
+	priqueue_init_bucket(&q, compare1, key_twenties);
+	priqueue_offer(&q, &values[30]);
+	priqueue_offer(&q, &values[10]);
+	printf("Bucket offer at the front: %d (expected 0).\n", priqueue_offer(&q, &values[5]));
+	priqueue_offer(&q, &values[20]);
+	printf("Bucket element at 2: %d (expected 20).\n", *((int *)priqueue_at(&q, 2)) );
+	printf("Bucket elements removed: %d (expected 1).\n", priqueue_remove(&q, &values[10]));
+	printf("Bucket element removed at 1: %d (expected 20).\n", *((int *)priqueue_remove_at(&q, 1)) );
+	priqueue_offer(&q, &values[1]);
+	printf("Bucket drained (expected 1 5 30): ");
+	while ((elem = priqueue_poll(&q)) != NULL)
+		printf("%d ", *elem);
+	printf("\n");
+	priqueue_destroy(&q);
+
+	/* Keys past PRIQUEUE_BUCKET_LIMIT share an overflow list, drained last. */
+	int huge[3] = { INT_MAX, PRIQUEUE_BUCKET_LIMIT, INT_MAX - 1 };
+	priqueue_init_bucket(&q, compare1, key_value);
+	priqueue_offer(&q, &huge[0]);
+	priqueue_offer(&q, &values[7]);
+	priqueue_offer(&q, &huge[1]);
+	priqueue_offer(&q, &huge[2]);
+	priqueue_offer(&q, &values[3]);
+	printf("Bucket array after overflow keys: %d (expected 64).\n", q.num_buckets);
+	printf("Overflow element at 3: %d (expected %d).\n", *((int *)priqueue_at(&q, 3)), INT_MAX - 1);
+	printf("Bucket with overflow drained (expected 3 7 %d %d %d): ", PRIQUEUE_BUCKET_LIMIT, INT_MAX - 1, INT_MAX);
+	while ((elem = priqueue_poll(&q)) != NULL)
+		printf("%d ", *elem);
+	printf("\n");
+	priqueue_destroy(&q);
+
+	priqueue_init_backend(&h, compare_tens, PRIQUEUE_LIST);
+	priqueue_init_bucket(&q, compare_tens, key_twenties);
+	for (i = 0; i < 100; i++)
+	{
+		priqueue_offer(&h, batch[i]);
+		priqueue_offer(&q, batch[i]);
+	}
+	priqueue_iter_t bit;
+	priqueue_iter_begin(&q, &bit);
+	stable = 1;
+	for (i = 0; i < 100; i++)
+		if (priqueue_iter_next(&bit) != priqueue_at(&h, i))
+			stable = 0;
+	while (priqueue_size(&h) > 0)
+		if (priqueue_poll(&q) != priqueue_poll(&h))
+			stable = 0;
+	printf("List and bucket agree on tie order: %d (expected 1).\n", stable && priqueue_size(&q) == 0);
+	priqueue_destroy(&h);
+	priqueue_destroy(&q);
+
+	/* Intrusive queues link elements through their own priqueue_link_t. */
+	linked_int_t linked[6];
+	int linked_values[6] = { 30, 10, 50, 20, 40, 0 };
+	priqueue_backend_t linked_backends[2] = { PRIQUEUE_LIST, PRIQUEUE_HEAP };
+	const char *linked_names[2] = { "list", "heap" };
+	int b;
+	for (b = 0; b < 2; b++)
+	{
+		memset(linked, 0, sizeof(linked));
+		for (i = 0; i < 6; i++)
+			linked[i].value = linked_values[i];
+
+		priqueue_init_backend(&q, compare_linked, linked_backends[b]);
+		priqueue_set_intrusive(&q, offsetof(linked_int_t, link));
+		for (i = 0; i < 3; i++)
+			priqueue_offer(&q, &linked[i]);
+		void *more[2] = { &linked[3], &linked[4] };
+		priqueue_offer_bulk(&q, more, 2);
+
+		int first = priqueue_remove(&q, &linked[2]);
+		int again = priqueue_remove(&q, &linked[2]);
+		int never = priqueue_remove(&q, &linked[5]);
+		printf("Intrusive %s removes: %d %d %d (expected 1 0 0).\n", linked_names[b], first, again, never);
+		priqueue_remove(&q, &linked[0]);
+		priqueue_offer(&q, &linked[5]);
+
+		priqueue_pool_stats(&q, &hits, &misses);
+		printf("Intrusive %s node allocations: %lu (expected 0).\n", linked_names[b], hits + misses);
+		printf("Intrusive %s drained (expected 0 10 20 40): ", linked_names[b]);
+		linked_int_t *linked_elem;
+		while ((linked_elem = priqueue_poll(&q)) != NULL)
+			printf("%d ", linked_elem->value);
+		printf("\n");
+		priqueue_destroy(&q);
+	}
+
+	/* The sharded queue hands back every element; one shard keeps strict order. */
+	cpriqueue_t cq;
+	cpriqueue_init(&cq, compare1, 4);
+	for (i = 0; i < 100; i++)
+		cpriqueue_offer(&cq, &values[(i * 37) % 100]);
+
+	int sum = 0;
+	printf("Sharded queue size: %d (expected 100).\n", cpriqueue_size(&cq));
+	printf("Sharded queue peek: %d (expected 0).\n", *((int *)cpriqueue_peek(&cq)) );
+	while ((elem = cpriqueue_poll(&cq)) != NULL)
+		sum += *elem;
+	printf("Sharded queue drained sum: %d (expected 4950).\n", sum);
+	cpriqueue_destroy(&cq);
+
+	cpriqueue_init(&cq, compare1, 1);
+	cpriqueue_offer(&cq, &values[30]);
+	cpriqueue_offer(&cq, &values[10]);
+	cpriqueue_offer(&cq, &values[20]);
+	printf("Single shard drained (expected 10 20 30): ");
+	while ((elem = cpriqueue_poll(&cq)) != NULL)
+		printf("%d ", *elem);
+	printf("\n");
+	cpriqueue_destroy(&cq);
+
+	free(values);
+
+	return 0;
+}
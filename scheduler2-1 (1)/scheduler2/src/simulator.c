@@ -1,492 +1,2080 @@
-/*
- * CS 241
- * The University of Illinois
- */
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <string.h>
-#include <assert.h>
-
-#include "libscheduler/libscheduler.h"
-
-
-typedef struct _simulator_job_list_t
-{
-	int job_id, arrival_time, run_time, priority;
-	int core_id, arrived;
-} simulator_job_list_t;
-
-void print_usage(char *program_name)
-{
-	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <input file>\n", program_name);
-	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
-	fprintf(stderr, "\n");
-	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#\n");
-}
-
-int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs)
-{
-	int i;
-	for (i = 0; i < active_jobs; i++)
-	{
-		if (jobs[i].job_id == job_id && jobs[i].arrived)
-		{
-			jobs[i].core_id = core_id;
-			return 1;
-		}
-	}
-
-	return 0;
-}
-
-void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
-{
-	printf("Active jobs are: ");
-
-	int i, first = 1;
-	for (i = 0; i < active_jobs; i++)
-	{
-		if (jobs[i].arrived)
-		{
-			if (first)
-			{
-				printf("%d", jobs[i].job_id);
-				first = 0;
-			}
-			else
-				printf(", %d", jobs[i].job_id);
-		}
-	}
-
-	if (!first)
-		printf("\n");
-}
-
-void print_available_cores(int cores)
-{
-	printf("Active cores are: ");
-
-	int i;
-	for (i = 0; i < cores; i++)
-	{
-		if (i == cores - 1)
-			printf("%d\n", i);
-		else
-			printf("%d, ", i);
-	}
-}
-
-
-int main(int argc, char **argv)
-{
-	int c;
-	int cores = 0, scheme = -1, quantum = 0;
-	char *file_name;
-
-	/*
-	 * Parse command line options.
-	 */
-	while ((c = getopt(argc, argv, "c:s:")) != -1)
-	{
-		switch (c)
-		{
-			case 'c':
-				cores = atoi(optarg);
-
-				if (cores <= 0)
-				{
-					fprintf(stderr, "Option -c <cores> require a positive number.\n");
-					print_usage(argv[0]);
-					return 1;
-				}
-				break;
-
-			case 's':
-				if (strcasecmp(optarg, "FCFS") == 0) { scheme = FCFS; }
-				else if (strcasecmp(optarg, "SJF") == 0) { scheme = SJF; }
-				else if (strcasecmp(optarg, "PSJF") == 0) { scheme = PSJF; }
-				else if (strcasecmp(optarg, "PRI") == 0) { scheme = PRI; }
-				else if (strcasecmp(optarg, "PPRI") == 0) { scheme = PPRI; }
-				else if (strncasecmp(optarg, "RR", 2) == 0)
-				{
-					scheme = RR;
-					quantum = atoi(optarg + 2);
-
-					if (quantum <= 0)
-					{
-						fprintf(stderr, "Option -s <scheme> requires a positive number for the quantum of RR. (Eg: -s RR2)\n");
-						print_usage(argv[0]);
-						return 1;
-					}
-				}
-				break;
-
-			case '?':
-				print_usage(argv[0]);
-				return 1;
-
-			default:
-				printf("....\n");
-				break;
-		}
-	}
-
-	if (cores == 0)
-	{
-		fprintf(stderr, "Required option -c <cores> is not present.\n");
-		print_usage(argv[0]);
-		return 1;
-	}
-
-	if (scheme == -1)
-	{
-		fprintf(stderr, "Required option -s <scheme> is not present.\n");
-		print_usage(argv[0]);
-		return 1;
-	}
-
-	if (optind == argc - 1)
-		file_name = argv[optind];
-	else
-	{
-		fprintf(stderr, "A single input file is required.\n");
-		print_usage(argv[0]);
-		return 1;
-	}
-
-
-	/*
-	 * Open the file, read the file, and populate the jobs data structure.
-	 */
-	FILE *file = fopen(file_name, "r");
-	if (file == NULL)
-	{
-		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
-		return 2;
-	}
-
-
-	int job_id = 0;
-	int jobs_ct = 10;
-	simulator_job_list_t* jobs = malloc(jobs_ct * sizeof(simulator_job_list_t));
-
-	char line[1024 + 1];
-	fgets(line, 1024, file);  // Ignore the first (header) line
-	while (fgets(line, 1024, file) != NULL)
-	{
-		char *arrival_time = strtok(line, ",");
-		char *run_time = strtok(NULL, ",");
-		char *priority = strtok(NULL, ",");
-
-		if (arrival_time != NULL && run_time != NULL && priority != NULL)
-		{
-			if (job_id == jobs_ct)
-			{
-				jobs_ct *= 2;
-				jobs = realloc(jobs, jobs_ct * sizeof(simulator_job_list_t));
-
-				if (!jobs)
-				{
-					fprintf(stderr, "Out of memory.\n");
-					return 2;
-				}
-			}
-
-			jobs[job_id].job_id = job_id;
-			jobs[job_id].arrival_time = atoi(arrival_time);
-			jobs[job_id].run_time = atoi(run_time);
-			jobs[job_id].priority = atoi(priority);
-			jobs[job_id].core_id = -1;
-			jobs[job_id].arrived = 0;
-
-			job_id++;
-		}
-		else
-		{
-			fprintf(stderr, "Illegal file format.\n");
-			return 2;
-		}
-	}
-
-	fclose(file);
-
-
-	/*
-	 * Run the simulation.
-	 */
-
-	printf("Loaded %d core(s) and %d job(s) using ", cores, job_id);
-	if (scheme == FCFS) { printf("First Come First Served (FCFS)"); }
-	else if (scheme == SJF) { printf("Non-preemptive Shortest Job First (SJF)"); }
-	else if (scheme == PSJF) { printf("Preemptive Shortest Job First (PSJF)"); }
-	else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
-	else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
-	else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
-	printf(" scheduling...\n\n");
-
-	scheduler_start_up(cores, scheme);
-
-
-	int time = 0, i, j;
-	int active_jobs = job_id, jobs_alive = 0;
-
-	int *quantum_clock = malloc(cores * sizeof(int));
-	char **core_timing_diagram = malloc(cores * sizeof(char *));
-	int core_timing_diagram_size = 1024;
-
-	for (i = 0; i < cores; i++)
-	{
-		quantum_clock[i] = -1;
-		core_timing_diagram[i] = malloc(core_timing_diagram_size + 1);
-		core_timing_diagram[i][0] = '\0';
-	}
-
-	while (active_jobs > 0)
-	{
-		printf("=== [TIME %d] ===\n", time);
-
-		/*
-		 * 1. Check if any jobs finished in the last time unit.
-		 */
-		for (i = 0; i < active_jobs; i++)
-		{
-			if (jobs[i].run_time == 0)
-			{
-				// Notify the scheduler has finished
-				int job_id = jobs[i].job_id;
-				int core_id = jobs[i].core_id;
-				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
-
-				if (scheme == RR)
-					quantum_clock[jobs[i].core_id] = quantum;
-
-				// Delete the finished jobs, decrease the number of active jobs
-				if (i != active_jobs - 1)
-					memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(simulator_job_list_t));
-				active_jobs--;
-				jobs_alive--;
-				i--;
-
-				// Set the new job
-				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
-				{
-					printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
-					print_available_jobs(jobs, active_jobs);
-					return 3;
-				}
-				else
-				{
-					printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-				}
-			}
-		}
-
-		/*
-		 * Check to see if we finished our last job.  (If we don't check here, we would run an extra time unit that will be totally idle.)
-		 */
-		if (active_jobs == 0)
-			break;
-
-		/*
-		 * 2. Check of any quantums expired in the last time unit.
-		 */
-		if (scheme == RR)
-		{
-			for (i = 0; i < cores; i++)
-			{
-				if (quantum_clock[i] == 0)
-				{
-					for (j = 0; j < active_jobs; j++)
-					{
-						if (jobs[j].core_id == i)
-						{
-							// Notify the scheduler the quantum has expired
-							int core_id = jobs[j].core_id;
-							int old_job_id = jobs[j].job_id;
-							int new_job_id = scheduler_quantum_expired(jobs[j].core_id, time);
-
-							jobs[j].core_id = -1;
-
-							quantum_clock[core_id] = quantum;
-
-							// Set the new job
-							if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
-							{
-								printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
-								print_available_jobs(jobs, active_jobs);
-								return 3;
-							}
-							else
-							{
-								printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
-								printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-							}
-
-							break;
-						}
-					}
-				}
-			}
-		}
-
-
-		/*
-		 * 3. Check for any new jobs that arrive in this time unit
-		 */
-		for (i = 0; i < active_jobs; i++)
-		{
-			if (jobs[i].arrival_time == time)
-			{
-				int new_job_core_id = scheduler_new_job(jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
-				jobs[i].arrived = 1;
-				jobs_alive++;
-
-				if (new_job_core_id >= 0 && new_job_core_id < cores)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-
-					// Find if anyone is currently using the core.
-					for (j = 0; j < active_jobs; j++)
-						if (jobs[j].core_id == new_job_core_id)
-							jobs[j].core_id = -1;
-
-					// Assign the core to the new job
-					jobs[i].core_id = new_job_core_id;
-
-					if (scheme == RR)
-						quantum_clock[new_job_core_id] = quantum;
-				}
-				else if (new_job_core_id == -1)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-				}
-				else
-				{
-					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
-					print_available_cores(cores);
-					return 3;
-				}
-			}
-		}
-
-
-		/*
-		 * 4. Run the time unit.
-		 */
-		char time_string[cores][11];
-		int cores_working = 0;
-
-		for (i = 0; i < cores; i++)
-			time_string[i][0] = '\0';
-
-		for (i = 0; i < active_jobs; i++)
-		{
-			if (jobs[i].core_id != -1)
-			{
-				cores_working++;
-				jobs[i].run_time--;
-				quantum_clock[jobs[i].core_id]--;
-
-				assert(time_string[jobs[i].core_id][0] == '\0');
-
-				if (jobs[i].job_id < 10)
-					sprintf(time_string[jobs[i].core_id], "%d", jobs[i].job_id);
-				else if (jobs[i].job_id < 10 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 + 'a');
-				else if (jobs[i].job_id < 10 + 26 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 - 26 + 'A');
-				else
-					snprintf(time_string[jobs[i].core_id], 10, "(%d)", jobs[i].job_id);
-			}
-		}
-
-		for (i = 0; i < cores; i++)
-		{
-			// If the core is idle, print a '-'
-			if (time_string[i][0] == '\0')
-				strcpy(time_string[i], "-");
-
-			// Ensure we have enough memory
-			while (strlen(core_timing_diagram[i]) + strlen(time_string[i]) >= (unsigned int)core_timing_diagram_size)
-			{
-				core_timing_diagram_size *= 2;
-
-				for (j = 0; j < cores; j++)
-				{
-					core_timing_diagram[j] = realloc(core_timing_diagram[j], core_timing_diagram_size + 1);
-
-					if (core_timing_diagram[j] == NULL)
-					{
-						fprintf(stderr, "Out of memory.\n");
-						return 3;
-					}
-				}
-			}
-
-			strcat( core_timing_diagram[i], time_string[i] );
-		}
-
-
-		/*
-		 * 5. Print data!
-		 */
-		printf("At the end of time unit %d...\n", time);
-
-		for (i = 0; i < cores; i++)
-			printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
-
-		printf("\n");
-
-		printf("  Queue: ");
-		scheduler_show_queue();
-		printf("\n");
-		printf("\n");
-
-
-		/*
-		 * 6. Sanity Checking
-		 *
-		 * - If there's a job alive (needing to be ran) and all CPUs are idle, the scheduler failed to schedule properly.
-		 */
-		if (jobs_alive > 0 && cores_working == 0)
-		{
-			printf("All cores are idle and at least one job remains unscheduled.\n");
-			print_available_jobs(jobs, active_jobs);
-			return 3;
-		}
-
-
-		/*
-		 * 7. Increase time
-		 */
-		time++;
-	}
-
-
-	printf("FINAL TIMING DIAGRAM:\n");
-	for (i = 0; i < cores; i++)
-		printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
-
-	printf("\n");
-	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time());
-	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
-	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
-
-	scheduler_clean_up();
-
-
-	free(quantum_clock);
-	for (i=0; i < cores; i++)
-		free(core_timing_diagram[i]);
-	free(core_timing_diagram);
-	free(jobs);
-
-	return 0;
-}
+/*
+ * CS 241
+ * The University of Illinois
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "libscheduler/libscheduler.h"
+#include "libpriqueue/priqueue_typed.h"
+#include "libtrace/libtrace.h"
+
+
+// Room for "(%d)" of any job id
+#define JOB_SYMBOL_SIZE 13
+
+// What -w sweeps over unless told otherwise
+#define SWEEP_CORES "1,2,4"
+#define SWEEP_SCHEMES "fcfs,sjf,psjf,pri,ppri,rr1,rr2,rr4"
+#define SWEEP_MAX 64
+
+#define TIME_SLICED(scheme) ((scheme) == RR || (scheme) == MLFQ || (scheme) == CFS)
+
+/*
+ * Settings of a scheme beyond the RR quantum. Zero (no levels, no
+ * granularity) leaves the library's defaults.
+ */
+typedef struct _scheme_options_t
+{
+	mlfq_config_t mlfq;
+	int cfs_granularity, cfs_latency;
+} scheme_options_t;
+
+typedef struct _simulator_job_list_t
+{
+	int job_id, arrival_time, run_time, priority, deadline;
+	int core_id, arrived, last_core;
+} simulator_job_list_t;
+
+/*
+ * What putting a job on a core costs (-x), in time units the job spends
+ * on the core without getting any of its work done. Every switch pays
+ * context_switch; a job that ran before also refills its cache, paying
+ * warmup on the core it last ran on and migration on any other.
+ */
+typedef struct _switch_costs_t
+{
+	int context_switch, warmup, migration;
+} switch_costs_t;
+
+typedef struct _switch_model_t
+{
+	switch_costs_t costs;
+	scheduler_t *scheduler;	// told of every cost, so its remaining times match
+	int *last_job;		// job_id of the job each core ran last, or -1
+	long long *overhead;	// time each core has spent switching
+} switch_model_t;
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> [-b <queue>] [-p <balancing>] [-m <cost>] [-x <costs>] [-e] [-S] [-q] [-r] [-P] <input file>\n", program_name);
+	fprintf(stderr, "       %s -w <threads> [-c <cores>,...] [-s <scheme>,...] [-b <queue>] <input file>\n", program_name);
+	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, mlfq[#:#:...][@#], cfs[#[:#]], edf, rm\n");
+	fprintf(stderr, "  mlfq takes the quantum of each level, highest first, and how often all jobs are\n");
+	fprintf(stderr, "  boosted back to the highest level (Eg: mlfq2:4:8@100, the default).\n");
+	fprintf(stderr, "  cfs takes the minimum granularity and the target latency (Eg: cfs2:12, the default).\n");
+	fprintf(stderr, "Acceptable queues are: heap (default), bucket\n");
+	fprintf(stderr, "-p gives every core its own ready queue, balanced by a comma-separated list of:\n");
+	fprintf(stderr, "   none, steal (an idle core takes from the longest queue), push# (even out every # time units).\n");
+	fprintf(stderr, "-m prints the cost of migrations, at <cost> time units per job moved to another core.\n");
+	fprintf(stderr, "-x charges every switch of a core to another job, as <switch>[:<warmup>[:<migration>]]:\n");
+	fprintf(stderr, "   the switch, plus refilling the cache of a job that ran before on the same core\n");
+	fprintf(stderr, "   or on another one (Eg: -x 1:2:5). The time each core lost is printed too.\n");
+	fprintf(stderr, "-e jumps from event to event instead of simulating every time unit.\n");
+	fprintf(stderr, "The input file is a CSV trace or a binary trace made by csv2trace.\n");
+	fprintf(stderr, "A fourth column gives each job's deadline after its arrival (its period, for rm);\n");
+	fprintf(stderr, "   the deadline miss rate and lateness percentiles are then printed too.\n");
+	fprintf(stderr, "-S streams jobs from the file as they arrive (implies -e, the file must be sorted by arrival time).\n");
+	fprintf(stderr, "-q prints only the final averages.\n");
+	fprintf(stderr, "-P also prints the p50, p90, p99, p99.9 and maximum waiting, turnaround and response times.\n");
+	fprintf(stderr, "-r prints timing diagrams run-length encoded, as <job>*<time units>.\n");
+	fprintf(stderr, "-w simulates every combination of the listed cores and schemes on a pool of threads\n");
+	fprintf(stderr, "   and prints their averages as CSV (by default -c %s -s %s).\n", SWEEP_CORES, SWEEP_SCHEMES);
+}
+
+/*
+ * Parses the -p list of load balancing policies for per-core queues.
+ * Returns 0, or -1 if an entry is unknown or a push interval is not positive.
+ */
+int parse_balancing(char *list, int *steal, int *push_interval)
+{
+	char *entry, *save;
+
+	*steal = 0;
+	*push_interval = 0;
+	for (entry = strtok_r(list, ",", &save); entry != NULL; entry = strtok_r(NULL, ",", &save))
+	{
+		if (strcasecmp(entry, "NONE") == 0) { }
+		else if (strcasecmp(entry, "STEAL") == 0) { *steal = 1; }
+		else if (strncasecmp(entry, "PUSH", 4) == 0)
+		{
+			*push_interval = atoi(entry + 4);
+			if (*push_interval <= 0)
+				return -1;
+		}
+		else
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ * Parses the -x costs: the context switch, then optionally the cache
+ * warmup and the migration penalty, separated by colons. Costs left out
+ * are 0.
+ * Returns 0, or -1 if a cost is not a number that is not negative.
+ */
+int parse_switch_costs(const char *spec, switch_costs_t *costs)
+{
+	int *fields[] = { &costs->context_switch, &costs->warmup, &costs->migration };
+	char *end;
+	long value;
+	int i;
+
+	memset(costs, 0, sizeof(switch_costs_t));
+	for (i = 0; i < 3; i++)
+	{
+		value = strtol(spec, &end, 10);
+		if (end == spec || value < 0 || value > INT_MAX / 4)
+			return -1;
+		*fields[i] = value;
+
+		if (*end != ':' || i == 2)
+			break;
+		spec = end + 1;
+	}
+
+	return *end == '\0' ? 0 : -1;
+}
+
+const char *scheme_names[] = { "fcfs", "sjf", "psjf", "pri", "ppri", "rr", "mlfq", "cfs", "edf", "rm" };
+
+/*
+ * Parses what follows "mlfq" in a scheme name: the quanta of the levels
+ * separated by colons, then optionally @ and the boost interval. An empty
+ * spec sets levels to 0, meaning the library's default shape; quanta
+ * without a boost interval are never boosted.
+ * Returns 0, or -2 if a quantum or the interval is not positive.
+ */
+int parse_mlfq(const char *spec, mlfq_config_t *mlfq)
+{
+	char *end;
+	long value;
+
+	mlfq->levels = 0;
+	mlfq->boost_interval = 0;
+	if (*spec == '\0')
+		return 0;
+
+	while (1)
+	{
+		value = strtol(spec, &end, 10);
+		if (end == spec || value <= 0 || mlfq->levels == MLFQ_MAX_LEVELS)
+			return -2;
+		mlfq->quanta[mlfq->levels++] = value;
+
+		spec = end;
+		if (*spec != ':')
+			break;
+		spec++;
+	}
+
+	if (*spec == '@')
+	{
+		value = strtol(spec + 1, &end, 10);
+		if (end == spec + 1 || value <= 0)
+			return -2;
+		mlfq->boost_interval = value;
+		spec = end;
+	}
+
+	return *spec == '\0' ? 0 : -2;
+}
+
+/*
+ * Parses what follows "cfs" in a scheme name: the minimum granularity,
+ * then optionally a colon and the target latency. An empty spec leaves
+ * the library's defaults; without a latency it is the granularity.
+ * Returns 0, or -2 if either is not positive.
+ */
+int parse_cfs(const char *spec, scheme_options_t *options)
+{
+	char *end;
+
+	if (*spec == '\0')
+		return 0;
+
+	options->cfs_granularity = strtol(spec, &end, 10);
+	options->cfs_latency = options->cfs_granularity;
+	if (end == spec || options->cfs_granularity <= 0)
+		return -2;
+
+	if (*end == ':')
+	{
+		spec = end + 1;
+		options->cfs_latency = strtol(spec, &end, 10);
+		if (end == spec || options->cfs_latency <= 0)
+			return -2;
+	}
+
+	return *end == '\0' ? 0 : -2;
+}
+
+/*
+ * Prints the settings of a scheme the way parse_scheme() reads them after
+ * its name.
+ */
+void print_scheme_options(const scheme_options_t *options)
+{
+	int i;
+	for (i = 0; i < options->mlfq.levels; i++)
+		printf("%s%d", i ? ":" : "", options->mlfq.quanta[i]);
+	if (options->mlfq.boost_interval > 0)
+		printf("@%d", options->mlfq.boost_interval);
+	if (options->cfs_granularity > 0)
+		printf("%d:%d", options->cfs_granularity, options->cfs_latency);
+}
+
+/*
+ * Puts the settings of a scheme into the configuration of a scheduler,
+ * leaving those it does not give.
+ */
+void apply_scheme_options(scheduler_config_t *config, const scheme_options_t *options)
+{
+	if (options->mlfq.levels > 0)
+		config->mlfq = options->mlfq;
+	if (options->cfs_granularity > 0)
+	{
+		config->cfs_granularity = options->cfs_granularity;
+		config->cfs_latency = options->cfs_latency;
+	}
+}
+
+/*
+ * Parses a scheme name such as "sjf", "rr2", "mlfq2:4:8@100" or "cfs2:12".
+ * Returns 0, -1 if the name is unknown, or -2 if a setting of RR, MLFQ or
+ * CFS is not positive.
+ */
+int parse_scheme(const char *name, int *scheme, int *quantum, scheme_options_t *options)
+{
+	*quantum = 0;
+	memset(options, 0, sizeof(scheme_options_t));
+	if (strcasecmp(name, "FCFS") == 0) { *scheme = FCFS; }
+	else if (strcasecmp(name, "SJF") == 0) { *scheme = SJF; }
+	else if (strcasecmp(name, "PSJF") == 0) { *scheme = PSJF; }
+	else if (strcasecmp(name, "PRI") == 0) { *scheme = PRI; }
+	else if (strcasecmp(name, "PPRI") == 0) { *scheme = PPRI; }
+	else if (strcasecmp(name, "EDF") == 0) { *scheme = EDF; }
+	else if (strcasecmp(name, "RM") == 0) { *scheme = RM; }
+	else if (strncasecmp(name, "MLFQ", 4) == 0)
+	{
+		*scheme = MLFQ;
+		return parse_mlfq(name + 4, &options->mlfq);
+	}
+	else if (strncasecmp(name, "CFS", 3) == 0)
+	{
+		*scheme = CFS;
+		return parse_cfs(name + 3, options);
+	}
+	else if (strncasecmp(name, "RR", 2) == 0)
+	{
+		*scheme = RR;
+		*quantum = atoi(name + 2);
+
+		if (*quantum <= 0)
+			return -2;
+	}
+	else
+		return -1;
+
+	return 0;
+}
+
+/*
+ * The value a core's quantum clock restarts at: the one RR quantum, or
+ * under MLFQ and CFS the slice the scheduler gives the job now on the core.
+ * Switch costs can leave a preempted job with nothing of its slice; it
+ * still runs for a time unit, or it would never be seen to expire.
+ */
+int next_quantum(scheduler_t *scheduler, int scheme, int quantum, int core_id)
+{
+	if (scheme == RR)
+		return quantum;
+
+	int slice = scheduler_time_slice_r(scheduler, core_id);
+	return slice > 0 ? slice : 1;
+}
+
+void print_percentiles(const char *name, metric_t metric)
+{
+	printf("%s p50: %d p90: %d p99: %d p99.9: %d Max: %d\n", name,
+			scheduler_percentile(metric, 50), scheduler_percentile(metric, 90), scheduler_percentile(metric, 99),
+			scheduler_percentile(metric, 99.9), scheduler_percentile(metric, 100));
+}
+
+void switch_model_init(switch_model_t *model, const switch_costs_t *costs, scheduler_t *scheduler, int cores)
+{
+	int i;
+
+	model->costs = *costs;
+	model->scheduler = scheduler;
+	model->last_job = malloc(cores * sizeof(int));
+	model->overhead = malloc(cores * sizeof(long long));
+	if (!model->last_job || !model->overhead)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		exit(3);
+	}
+
+	for (i = 0; i < cores; i++)
+	{
+		model->last_job[i] = -1;
+		model->overhead[i] = 0;
+	}
+}
+
+void switch_model_destroy(switch_model_t *model)
+{
+	free(model->last_job);
+	free(model->overhead);
+}
+
+/*
+ * Charges putting job on a core, if model is not NULL. The cost is added
+ * to the job's running time and, so the job still gets a whole quantum of
+ * work, to the core's quantum clock. The scheduler adds it to the job's
+ * remaining time and slice too, so PSJF and SJF decide on the time the job
+ * really has left. A core taking back the job it ran last pays nothing.
+ */
+void charge_switch(switch_model_t *model, simulator_job_list_t *job, int core_id, int *quantum_clock)
+{
+	if (!model || model->last_job[core_id] == job->job_id)
+		return;
+
+	int cost = model->costs.context_switch;
+	if (job->last_core == core_id)
+		cost += model->costs.warmup;
+	else if (job->last_core != -1)
+		cost += model->costs.migration;
+
+	job->run_time += cost;
+	quantum_clock[core_id] += cost;
+	scheduler_switch_cost_r(model->scheduler, core_id, cost);
+	model->overhead[core_id] += cost;
+	model->last_job[core_id] = job->job_id;
+	job->last_core = core_id;
+}
+
+void print_switch_overhead(switch_model_t *model, int cores)
+{
+	long long total = 0;
+	int i;
+
+	for (i = 0; i < cores; i++)
+		total += model->overhead[i];
+	printf("Switch Overhead: %lld\n", total);
+	for (i = 0; i < cores; i++)
+		printf("  Core %2d: %lld\n", i, model->overhead[i]);
+}
+
+int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs, switch_model_t *switches, int *quantum_clock)
+{
+	int i;
+	for (i = 0; i < active_jobs; i++)
+	{
+		if (jobs[i].job_id == job_id && jobs[i].arrived)
+		{
+			jobs[i].core_id = core_id;
+			charge_switch(switches, &jobs[i], core_id, quantum_clock);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
+{
+	printf("Active jobs are: ");
+
+	int i, first = 1;
+	for (i = 0; i < active_jobs; i++)
+	{
+		if (jobs[i].arrived)
+		{
+			if (first)
+			{
+				printf("%d", jobs[i].job_id);
+				first = 0;
+			}
+			else
+				printf(", %d", jobs[i].job_id);
+		}
+	}
+
+	if (!first)
+		printf("\n");
+}
+
+void print_available_cores(int cores)
+{
+	printf("Active cores are: ");
+
+	int i;
+	for (i = 0; i < cores; i++)
+	{
+		if (i == cores - 1)
+			printf("%d\n", i);
+		else
+			printf("%d, ", i);
+	}
+}
+
+/*
+ * Writes the timing diagram symbol for a job into s, which must hold
+ * JOB_SYMBOL_SIZE characters.
+ */
+void format_job_symbol(char *s, int job_id)
+{
+	if (job_id < 10)
+		sprintf(s, "%d", job_id);
+	else if (job_id < 10 + 26)
+		sprintf(s, "%c", job_id - 10 + 'a');
+	else if (job_id < 10 + 26 + 26)
+		sprintf(s, "%c", job_id - 10 - 26 + 'A');
+	else
+		snprintf(s, JOB_SYMBOL_SIZE, "(%d)", job_id);
+}
+
+
+/*
+ * Timing diagram of one core. It is kept as text, one symbol per time
+ * unit, or (with -r) as runs of the same job, which only take memory per
+ * change of job. With -q and without -r, neither is kept.
+ */
+typedef struct _diagram_run_t
+{
+	int job_id;		// -1 while the core is idle
+	int length;
+} diagram_run_t;
+
+typedef struct _core_diagram_t
+{
+	int keep_text, keep_runs;
+	char *text;
+	int text_length, text_size;
+	diagram_run_t *runs;
+	int num_runs, runs_size;
+} core_diagram_t;
+
+void diagram_init(core_diagram_t *d, int keep_text, int keep_runs)
+{
+	d->keep_text = keep_text;
+	d->keep_runs = keep_runs;
+
+	d->text_length = 0;
+	d->text_size = 1024;
+	d->text = malloc(d->text_size + 1);
+
+	d->num_runs = 0;
+	d->runs_size = 16;
+	d->runs = malloc(d->runs_size * sizeof(diagram_run_t));
+
+	if (d->text == NULL || d->runs == NULL)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		exit(3);
+	}
+	d->text[0] = '\0';
+}
+
+/*
+ * Adds count time units of job_id, or of idling for -1, to the diagram.
+ */
+void diagram_append(core_diagram_t *d, int job_id, int count)
+{
+	if (count <= 0)
+		return;
+
+	if (d->keep_runs)
+	{
+		if (d->num_runs > 0 && d->runs[d->num_runs - 1].job_id == job_id)
+			d->runs[d->num_runs - 1].length += count;
+		else
+		{
+			if (d->num_runs == d->runs_size)
+			{
+				d->runs_size *= 2;
+				d->runs = realloc(d->runs, d->runs_size * sizeof(diagram_run_t));
+
+				if (d->runs == NULL)
+				{
+					fprintf(stderr, "Out of memory.\n");
+					exit(3);
+				}
+			}
+			d->runs[d->num_runs].job_id = job_id;
+			d->runs[d->num_runs].length = count;
+			d->num_runs++;
+		}
+	}
+
+	if (d->keep_text)
+	{
+		char symbol[JOB_SYMBOL_SIZE];
+		if (job_id == -1)
+			strcpy(symbol, "-");
+		else
+			format_job_symbol(symbol, job_id);
+
+		// Track the length instead of strcat'ing, which rescans the whole diagram every time unit
+		int length = strlen(symbol);
+		while (d->text_length + length * count > d->text_size)
+		{
+			d->text_size *= 2;
+			d->text = realloc(d->text, d->text_size + 1);
+
+			if (d->text == NULL)
+			{
+				fprintf(stderr, "Out of memory.\n");
+				exit(3);
+			}
+		}
+
+		int i;
+		for (i = 0; i < count; i++, d->text_length += length)
+			memcpy(d->text + d->text_length, symbol, length);
+		d->text[d->text_length] = '\0';
+	}
+}
+
+void diagram_print(core_diagram_t *d)
+{
+	if (d->keep_runs)
+	{
+		char symbol[JOB_SYMBOL_SIZE];
+		int i;
+		for (i = 0; i < d->num_runs; i++)
+		{
+			if (d->runs[i].job_id == -1)
+				strcpy(symbol, "-");
+			else
+				format_job_symbol(symbol, d->runs[i].job_id);
+			printf("%s%s*%d", i == 0 ? "" : " ", symbol, d->runs[i].length);
+		}
+	}
+	else
+		printf("%s", d->text);
+}
+
+void diagram_destroy(core_diagram_t *d)
+{
+	free(d->text);
+	free(d->runs);
+}
+
+
+/*
+ * Event-driven simulation (-e).
+ *
+ * Rather than stepping one time unit at a time, the simulation jumps to the
+ * next arrival, completion or quantum expiry. Completions and expiries are
+ * kept in a heap of core events. Every change to a core bumps its stamp, so
+ * events pushed before the change are recognised as stale and skipped. A
+ * core's remaining run time, quantum clock and timing diagram are brought
+ * up to date only when the core is looked at.
+ *
+ * Within a time unit, events are handled in the order the tick loop meets
+ * them, including the order its swap-with-last deletes leave the jobs
+ * array in, so the scheduler sees exactly the same calls. Only the
+ * "At the end of time unit" output is left out.
+ *
+ * With -S, jobs are read from the trace only when they arrive and jobs[]
+ * holds just the jobs that have arrived and not finished, so memory stays
+ * proportional to the jobs in the system rather than to the trace. The
+ * order the tick loop meets jobs in still depends on where its deletes
+ * have moved every job, read or not, so -S keeps the place in the tick
+ * loop's jobs[] of each job that is no longer in its own (its job_id),
+ * and handles jobs that arrive or finish in the same time unit in that
+ * order. That is at most one entry for each job finished so far.
+ */
+typedef struct _sim_event_t
+{
+	int time;
+	int core_id;
+	unsigned int stamp;
+} sim_event_t;
+
+#define SIM_EVENT_LESS(a, b) \
+	((a)->time != (b)->time ? (a)->time < (b)->time : (a)->core_id < (b)->core_id)
+
+PRIQUEUE_DEFINE(eventq, sim_event_t, SIM_EVENT_LESS, PRIQUEUE_NO_MOVE)
+
+typedef struct _sim_core_t
+{
+	int slot;		// index in jobs of the job running on the core, or -1
+	int since;		// time up to which the core has been accounted for
+	unsigned int stamp;
+	int due, dirty;
+} sim_core_t;
+
+/*
+ * Index in jobs of each job_id still in the simulation. Open addressing
+ * with linear probing; removals shift later entries back instead of
+ * leaving tombstones, so the table does not fill up as jobs stream through.
+ */
+typedef struct _slot_map_t
+{
+	int *keys, *values;
+	int size, mask;
+} slot_map_t;
+
+typedef struct _sim_state_t
+{
+	simulator_job_list_t *jobs;
+	int jobs_size, active_jobs, jobs_alive;
+	slot_map_t slot_of;
+	trace_t *stream;	// the trace jobs are streamed from, or NULL
+	int tick_jobs;		// with -S, the jobs the tick loop's jobs[] would still hold
+	slot_map_t position;	// with -S, the place there of each job moved out of its own
+	slot_map_t occupant;	// with -S, the job in each place holding another job's
+	trace_job_t pending;	// the next job of the stream, if has_pending
+	int has_pending, next_job_id;
+	scheduler_t *scheduler;
+	int cores, scheme, quantum;
+	int *quantum_clock;
+	switch_model_t *switches;	// NULL if switches are free
+	core_diagram_t *diagrams;
+	sim_core_t *core;
+	int *changed, num_changed;
+	int running;
+	eventq_t events;
+	int time;
+} sim_state_t;
+
+void slot_map_init(slot_map_t *m, int expected)
+{
+	int capacity = 16;
+	while (capacity < 2 * expected)
+		capacity *= 2;
+
+	m->keys = malloc(capacity * sizeof(int));
+	m->values = malloc(capacity * sizeof(int));
+	if (!m->keys || !m->values)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		exit(3);
+	}
+
+	memset(m->keys, -1, capacity * sizeof(int));
+	m->size = 0;
+	m->mask = capacity - 1;
+}
+
+void slot_map_destroy(slot_map_t *m)
+{
+	free(m->keys);
+	free(m->values);
+}
+
+static inline int slot_map_home(slot_map_t *m, int key)
+{
+	return ((unsigned int)key * 2654435761u) & m->mask;
+}
+
+/*
+ * Returns the value stored for a key, or -1 if there is none.
+ */
+int slot_map_get(slot_map_t *m, int key)
+{
+	int i = slot_map_home(m, key);
+	while (m->keys[i] != -1)
+	{
+		if (m->keys[i] == key)
+			return m->values[i];
+		i = (i + 1) & m->mask;
+	}
+	return -1;
+}
+
+void slot_map_put(slot_map_t *m, int key, int value);
+
+void slot_map_grow(slot_map_t *m)
+{
+	int *keys = m->keys, *values = m->values;
+	int i, capacity = m->mask + 1;
+
+	slot_map_init(m, capacity);
+	for (i = 0; i < capacity; i++)
+		if (keys[i] != -1)
+			slot_map_put(m, keys[i], values[i]);
+
+	free(keys);
+	free(values);
+}
+
+void slot_map_put(slot_map_t *m, int key, int value)
+{
+	int i = slot_map_home(m, key);
+	while (m->keys[i] != -1 && m->keys[i] != key)
+		i = (i + 1) & m->mask;
+
+	if (m->keys[i] == -1)
+	{
+		m->keys[i] = key;
+		m->size++;
+	}
+	m->values[i] = value;
+
+	if (2 * m->size > m->mask + 1)
+		slot_map_grow(m);
+}
+
+void slot_map_remove(slot_map_t *m, int key)
+{
+	int i = slot_map_home(m, key);
+	while (m->keys[i] != key)
+	{
+		if (m->keys[i] == -1)
+			return;
+		i = (i + 1) & m->mask;
+	}
+
+	// Move back any later entry of the run that may no longer be reachable
+	int j = i;
+	while (1)
+	{
+		j = (j + 1) & m->mask;
+		if (m->keys[j] == -1)
+			break;
+
+		int home = slot_map_home(m, m->keys[j]);
+		if (((j - home) & m->mask) >= ((j - i) & m->mask))
+		{
+			m->keys[i] = m->keys[j];
+			m->values[i] = m->values[j];
+			i = j;
+		}
+	}
+
+	m->keys[i] = -1;
+	m->size--;
+}
+
+int compare_arrival(const void *a, const void *b)
+{
+	const simulator_job_list_t *joba = a, *jobb = b;
+	if (joba->arrival_time != jobb->arrival_time)
+		return joba->arrival_time < jobb->arrival_time ? -1 : 1;
+	return joba->job_id - jobb->job_id;
+}
+
+int compare_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Runs the job on a core, if any, from the last time the core was
+ * accounted for up to now.
+ */
+void sim_sync(sim_state_t *s, int core_id)
+{
+	sim_core_t *core = &s->core[core_id];
+	int elapsed = s->time - core->since;
+
+	if (elapsed <= 0)
+		return;
+
+	if (core->slot != -1)
+	{
+		simulator_job_list_t *job = &s->jobs[core->slot];
+		job->run_time -= elapsed;
+		s->quantum_clock[core_id] -= elapsed;
+		diagram_append(&s->diagrams[core_id], job->job_id, elapsed);
+	}
+	else
+		diagram_append(&s->diagrams[core_id], -1, elapsed);
+
+	core->since = s->time;
+}
+
+/*
+ * Puts the job in jobs[slot] (or nothing, for -1) on a core.
+ */
+void sim_set_slot(sim_state_t *s, int core_id, int slot)
+{
+	sim_core_t *core = &s->core[core_id];
+
+	sim_sync(s, core_id);
+	s->running += (slot != -1) - (core->slot != -1);
+	core->slot = slot;
+
+	if (!core->dirty)
+	{
+		core->dirty = 1;
+		s->changed[s->num_changed++] = core_id;
+	}
+}
+
+/*
+ * Pushes the next event of a core that changed: its job finishing or its
+ * quantum expiring, whichever comes first. Either one changes the core
+ * again, so the later one never needs to be queued.
+ */
+void sim_reschedule(sim_state_t *s, int core_id)
+{
+	sim_core_t *core = &s->core[core_id];
+	sim_event_t event;
+
+	core->stamp++;
+	core->dirty = 0;
+	if (core->slot == -1)
+		return;
+
+	event.core_id = core_id;
+	event.stamp = core->stamp;
+	event.time = s->time + s->jobs[core->slot].run_time;
+	if (TIME_SLICED(s->scheme) && s->time + s->quantum_clock[core_id] < event.time)
+		event.time = s->time + s->quantum_clock[core_id];
+	eventq_offer(&s->events, event);
+}
+
+/*
+ * Event-driven counterpart of set_active_job().
+ */
+int sim_set_active_job(sim_state_t *s, int job_id, int core_id)
+{
+	int slot = slot_map_get(&s->slot_of, job_id);
+	if (slot == -1 || !s->jobs[slot].arrived)
+		return 0;
+
+	// A job can only run on one core.
+	int old_core_id = s->jobs[slot].core_id;
+	if (old_core_id != -1 && old_core_id != core_id)
+		sim_set_slot(s, old_core_id, -1);
+
+	s->jobs[slot].core_id = core_id;
+	sim_set_slot(s, core_id, slot);
+	charge_switch(s->switches, &s->jobs[slot], core_id, s->quantum_clock);
+	return 1;
+}
+
+/*
+ * Adds a job read from the stream to the end of jobs.
+ */
+void sim_add_job(sim_state_t *s, trace_job_t *job)
+{
+	if (s->active_jobs == s->jobs_size)
+	{
+		s->jobs_size = s->jobs_size ? s->jobs_size * 2 : 16;
+		s->jobs = realloc(s->jobs, s->jobs_size * sizeof(simulator_job_list_t));
+
+		if (!s->jobs)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			exit(3);
+		}
+	}
+
+	simulator_job_list_t *new_job = &s->jobs[s->active_jobs];
+	new_job->job_id = s->next_job_id++;
+	new_job->arrival_time = job->arrival_time;
+	new_job->run_time = job->run_time;
+	new_job->priority = job->priority;
+	new_job->deadline = job->deadline;
+	new_job->core_id = -1;
+	new_job->arrived = 0;
+	new_job->last_core = -1;
+
+	slot_map_put(&s->slot_of, new_job->job_id, s->active_jobs);
+	s->active_jobs++;
+}
+
+/*
+ * The place a job would have in the tick loop's jobs[] (with -S), or the
+ * job that would be in a place of it.
+ */
+int sim_position(sim_state_t *s, int job_id)
+{
+	int position = slot_map_get(&s->position, job_id);
+	return position == -1 ? job_id : position;
+}
+
+int sim_occupant(sim_state_t *s, int position)
+{
+	int job_id = slot_map_get(&s->occupant, position);
+	return job_id == -1 ? position : job_id;
+}
+
+/*
+ * Deletes a finished job from the tick loop's jobs[] the way the tick loop
+ * does, by moving the last job, arrived or not, into its place.
+ */
+void sim_tick_delete(sim_state_t *s, int job_id)
+{
+	int position = sim_position(s, job_id);
+	int last = --s->tick_jobs;
+	int moved = sim_occupant(s, last);
+
+	slot_map_remove(&s->position, job_id);
+	slot_map_remove(&s->occupant, last);
+	if (position == last)
+		return;
+
+	slot_map_put(&s->position, moved, position);
+	slot_map_put(&s->occupant, position, moved);
+}
+
+/*
+ * The order the tick loop meets the job in jobs[slot] in.
+ */
+int sim_order(sim_state_t *s, int slot)
+{
+	return s->stream ? sim_position(s, s->jobs[slot].job_id) : slot;
+}
+
+/*
+ * Sorts the streamed jobs in jobs[first..active_jobs), which have just
+ * arrived, into the order the tick loop meets them in. They are few and
+ * on no core yet, so an insertion sort moving only them will do.
+ */
+void sim_sort_arrivals(sim_state_t *s, int first)
+{
+	int i, j;
+
+	for (i = first + 1; i < s->active_jobs; i++)
+	{
+		simulator_job_list_t job = s->jobs[i];
+		int order = sim_position(s, job.job_id);
+
+		for (j = i; j > first && sim_order(s, j - 1) > order; j--)
+		{
+			s->jobs[j] = s->jobs[j - 1];
+			slot_map_put(&s->slot_of, s->jobs[j].job_id, j);
+		}
+		s->jobs[j] = job;
+		slot_map_put(&s->slot_of, job.job_id, j);
+	}
+}
+
+/*
+ * Reads the next job of the stream into s->pending. Jobs arriving at a
+ * negative time never arrive, as in the tick loop, so they go straight
+ * into jobs and stay there.
+ * Returns 0, or 2 if the trace is malformed or out of order.
+ */
+int sim_read_ahead(sim_state_t *s)
+{
+	int last_arrival = s->has_pending ? s->pending.arrival_time : 0;
+	int result;
+
+	while ((result = trace_next(s->stream, &s->pending)) == 1 && s->pending.arrival_time < 0)
+		sim_add_job(s, &s->pending);
+
+	s->has_pending = (result == 1);
+	if (result == -1)
+	{
+		fprintf(stderr, "Illegal file format.\n");
+		return 2;
+	}
+	if (s->has_pending && s->pending.arrival_time < last_arrival)
+	{
+		fprintf(stderr, "Jobs must be sorted by arrival time to be streamed (job %d).\n", s->next_job_id);
+		return 2;
+	}
+	return 0;
+}
+
+/*
+ * Runs the event-driven simulation with scheduler over jobs[0..num_jobs),
+ * or, if stream is not NULL, over the jobs of stream as they arrive (jobs
+ * and num_jobs are then ignored).
+ */
+int simulate_events(scheduler_t *scheduler, simulator_job_list_t *jobs, int num_jobs, trace_t *stream, int cores, int scheme, int quantum,
+		int *quantum_clock, switch_model_t *switches, core_diagram_t *diagrams, int quiet)
+{
+	sim_state_t state, *s = &state;
+	int i, j, status = 0;
+
+	if (stream)
+	{
+		jobs = NULL;
+		num_jobs = 0;
+	}
+
+	s->scheduler = scheduler;
+	s->jobs = jobs;
+	s->jobs_size = num_jobs;
+	s->active_jobs = num_jobs;
+	s->jobs_alive = 0;
+	s->stream = stream;
+	s->tick_jobs = stream ? trace_count(stream) : 0;
+	s->has_pending = 0;
+	s->next_job_id = 0;
+	s->cores = cores;
+	s->scheme = scheme;
+	s->quantum = quantum;
+	s->quantum_clock = quantum_clock;
+	s->switches = switches;
+	s->diagrams = diagrams;
+	s->num_changed = 0;
+	s->running = 0;
+	s->time = 0;
+	eventq_init(&s->events);
+
+	slot_map_init(&s->slot_of, num_jobs);
+	slot_map_init(&s->position, 0);
+	slot_map_init(&s->occupant, 0);
+	s->core = malloc(cores * sizeof(sim_core_t));
+	s->changed = malloc(cores * sizeof(int));
+	int *due = malloc(2 * cores * sizeof(int));
+	int *finishing = malloc(cores * sizeof(int));
+	int *arriving = malloc(num_jobs * sizeof(int));
+	simulator_job_list_t *arrivals = malloc(num_jobs * sizeof(simulator_job_list_t));
+
+	if ((num_jobs > 0 && (!arriving || !arrivals)) || !s->core || !s->changed || !due || !finishing)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		exit(3);
+	}
+
+	for (i = 0; i < num_jobs; i++)
+		slot_map_put(&s->slot_of, jobs[i].job_id, i);
+
+	for (i = 0; i < cores; i++)
+	{
+		s->core[i].slot = -1;
+		s->core[i].since = 0;
+		s->core[i].stamp = 0;
+		s->core[i].due = 0;
+		s->core[i].dirty = 0;
+	}
+
+	// Jobs arriving at a negative time never arrive, as in the tick loop.
+	if (num_jobs > 0)
+	{
+		memcpy(arrivals, jobs, num_jobs * sizeof(simulator_job_list_t));
+		qsort(arrivals, num_jobs, sizeof(simulator_job_list_t), compare_arrival);
+	}
+	int next_arrival = 0;
+	while (next_arrival < num_jobs && arrivals[next_arrival].arrival_time < 0)
+		next_arrival++;
+
+	if (stream && (status = sim_read_ahead(s)) != 0)
+		goto done;
+	jobs = s->jobs;
+
+	while (s->active_jobs > 0 || s->has_pending)
+	{
+		/*
+		 * Find the next time anything happens.
+		 */
+		while (eventq_size(&s->events) > 0 &&
+				eventq_peek(&s->events)->stamp != s->core[eventq_peek(&s->events)->core_id].stamp)
+			eventq_poll(&s->events, NULL);
+
+		int next_time = INT_MAX;
+		if (eventq_size(&s->events) > 0)
+			next_time = eventq_peek(&s->events)->time;
+		if (next_arrival < num_jobs && arrivals[next_arrival].arrival_time < next_time)
+			next_time = arrivals[next_arrival].arrival_time;
+		if (s->has_pending && s->pending.arrival_time < next_time)
+			next_time = s->pending.arrival_time;
+
+		if (next_time == INT_MAX)
+		{
+			printf("All cores are idle and at least one job remains unscheduled.\n");
+			print_available_jobs(jobs, s->active_jobs);
+			status = 3;
+			break;
+		}
+
+		s->time = next_time;
+		if (!quiet)
+			printf("=== [TIME %d] ===\n", s->time);
+
+		/*
+		 * Only cores with an event due now can finish a job or expire a quantum.
+		 */
+		int num_due = 0;
+		sim_event_t event;
+		while (eventq_size(&s->events) > 0 && eventq_peek(&s->events)->time == s->time)
+		{
+			eventq_poll(&s->events, &event);
+			if (event.stamp == s->core[event.core_id].stamp && !s->core[event.core_id].due)
+			{
+				s->core[event.core_id].due = 1;
+				due[num_due++] = event.core_id;
+				sim_sync(s, event.core_id);
+			}
+		}
+		qsort(due, num_due, sizeof(int), compare_int);
+
+		/*
+		 * 1. Finished jobs, in the tick loop's jobs[] order.
+		 */
+		int num_finishing = 0;
+		for (i = 0; i < num_due; i++)
+		{
+			int slot = s->core[due[i]].slot;
+			if (slot != -1 && jobs[slot].run_time == 0)
+				finishing[num_finishing++] = slot;
+		}
+
+		int scan = 0;
+		while (1)
+		{
+			int next = -1;
+			for (j = 0; j < num_finishing; j++)
+				if (sim_order(s, finishing[j]) >= scan &&
+						(next == -1 || sim_order(s, finishing[j]) < sim_order(s, finishing[next])))
+					next = j;
+			if (next == -1)
+				break;
+
+			i = finishing[next];
+			finishing[next] = finishing[--num_finishing];
+			scan = sim_order(s, i);
+
+			int job_id = jobs[i].job_id;
+			int core_id = jobs[i].core_id;
+			int new_job_id = scheduler_job_finished_r(scheduler, core_id, job_id, s->time);
+
+			sim_set_slot(s, core_id, -1);
+			if (TIME_SLICED(scheme))
+				quantum_clock[core_id] = next_quantum(scheduler, scheme, quantum, core_id);
+
+			// Delete the finished job the way the tick loop does, by moving the last job into its place
+			if (stream)
+				sim_tick_delete(s, job_id);
+			slot_map_remove(&s->slot_of, job_id);
+			int last = s->active_jobs - 1;
+			if (i != last)
+			{
+				memcpy(&jobs[i], &jobs[last], sizeof(simulator_job_list_t));
+				slot_map_put(&s->slot_of, jobs[i].job_id, i);
+				if (jobs[i].core_id != -1)
+					s->core[jobs[i].core_id].slot = i;
+				for (j = 0; j < num_finishing; j++)
+					if (finishing[j] == last)
+						finishing[j] = i;
+			}
+			s->active_jobs--;
+			s->jobs_alive--;
+
+			if ( new_job_id != -1 && !sim_set_active_job(s, new_job_id, core_id) )
+			{
+				printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
+				print_available_jobs(jobs, s->active_jobs);
+				status = 3;
+				goto done;
+			}
+			else if (!quiet)
+			{
+				printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+				printf("  Queue: "); scheduler_show_queue_r(scheduler); printf("\n\n");
+			}
+		}
+
+		if (s->active_jobs == 0 && !s->has_pending)
+			break;
+
+		/*
+		 * 2. Expired quantums, in core order.
+		 */
+		for (i = 0; i < num_due && TIME_SLICED(scheme); i++)
+		{
+			int core_id = due[i];
+			int slot = s->core[core_id].slot;
+			if (slot == -1 || quantum_clock[core_id] != 0)
+				continue;
+
+			int old_job_id = jobs[slot].job_id;
+			int new_job_id = scheduler_quantum_expired_r(scheduler, core_id, s->time);
+
+			jobs[slot].core_id = -1;
+			sim_set_slot(s, core_id, -1);
+			quantum_clock[core_id] = next_quantum(scheduler, scheme, quantum, core_id);
+
+			if ( new_job_id != -1 && !sim_set_active_job(s, new_job_id, core_id) )
+			{
+				printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
+				print_available_jobs(jobs, s->active_jobs);
+				status = 3;
+				goto done;
+			}
+			else if (!quiet)
+			{
+				printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
+				printf("  Queue: "); scheduler_show_queue_r(scheduler); printf("\n\n");
+			}
+		}
+
+		for (i = 0; i < num_due; i++)
+			s->core[due[i]].due = 0;
+
+		/*
+		 * 3. New jobs, in the tick loop's jobs[] order.
+		 */
+		int num_arriving = 0;
+		while (next_arrival < num_jobs && arrivals[next_arrival].arrival_time == s->time)
+			arriving[num_arriving++] = slot_map_get(&s->slot_of, arrivals[next_arrival++].job_id);
+		qsort(arriving, num_arriving, sizeof(int), compare_int);
+
+		// Streamed jobs are appended as they arrive, then put in order; jobs that never arrive can come between them
+		int first_streamed = s->active_jobs;
+		while (s->has_pending && s->pending.arrival_time == s->time)
+		{
+			sim_add_job(s, &s->pending);
+			if ((status = sim_read_ahead(s)) != 0)
+				goto done;
+		}
+		if (stream)
+		{
+			sim_sort_arrivals(s, first_streamed);
+			num_arriving = s->active_jobs - first_streamed;
+		}
+		jobs = s->jobs;
+
+		for (j = 0; j < num_arriving; j++)
+		{
+			i = stream ? first_streamed + j : arriving[j];
+			if (jobs[i].arrival_time != s->time)
+				continue;
+			int new_job_core_id = scheduler_new_deadline_job_r(scheduler, jobs[i].job_id, s->time, jobs[i].run_time,
+					jobs[i].priority, jobs[i].deadline);
+			jobs[i].arrived = 1;
+			s->jobs_alive++;
+
+			if (new_job_core_id >= 0 && new_job_core_id < cores)
+			{
+				if (!quiet)
+				{
+					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
+					printf("  Queue: "); scheduler_show_queue_r(scheduler); printf("\n\n");
+				}
+
+				// Take the core from whoever is using it
+				sim_sync(s, new_job_core_id);
+				if (s->core[new_job_core_id].slot != -1)
+					jobs[s->core[new_job_core_id].slot].core_id = -1;
+
+				jobs[i].core_id = new_job_core_id;
+				sim_set_slot(s, new_job_core_id, i);
+
+				if (TIME_SLICED(scheme))
+					quantum_clock[new_job_core_id] = next_quantum(scheduler, scheme, quantum, new_job_core_id);
+				charge_switch(switches, &jobs[i], new_job_core_id, quantum_clock);
+			}
+			else if (new_job_core_id == -1)
+			{
+				if (!quiet)
+				{
+					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
+					printf("  Queue: "); scheduler_show_queue_r(scheduler); printf("\n\n");
+				}
+			}
+			else
+			{
+				printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
+				print_available_cores(cores);
+				status = 3;
+				goto done;
+			}
+		}
+
+		/*
+		 * 4. Sanity checking, as in the tick loop.
+		 */
+		if (s->jobs_alive > 0 && s->running == 0)
+		{
+			printf("All cores are idle and at least one job remains unscheduled.\n");
+			print_available_jobs(jobs, s->active_jobs);
+			status = 3;
+			break;
+		}
+
+		for (i = 0; i < s->num_changed; i++)
+			sim_reschedule(s, s->changed[i]);
+		s->num_changed = 0;
+	}
+
+	// Run the diagram up to the time the last job finished
+	for (i = 0; i < cores; i++)
+		sim_sync(s, i);
+
+done:
+	eventq_destroy(&s->events);
+	free(arrivals);
+	free(arriving);
+	free(finishing);
+	free(due);
+	free(s->changed);
+	free(s->core);
+	slot_map_destroy(&s->slot_of);
+	slot_map_destroy(&s->position);
+	slot_map_destroy(&s->occupant);
+	if (stream)
+		free(s->jobs);
+	return status;
+}
+
+
+/*
+ * Parameter sweep (-w).
+ *
+ * Runs the event-driven simulation for every combination of core count and
+ * scheme over the same jobs, spread over a pool of threads, and prints one
+ * CSV row of averages per combination. Every run has a scheduler_t of its
+ * own, so the workers' simulations do not interfere.
+ */
+typedef struct _sweep_run_t
+{
+	int cores, scheme, quantum;
+	scheme_options_t options;
+	int status;
+	float waiting_time, turnaround_time, response_time;
+	long long switch_overhead;
+} sweep_run_t;
+
+typedef struct _sweep_t
+{
+	simulator_job_list_t *jobs;
+	int num_jobs;
+	const scheduler_config_t *config;
+	const switch_costs_t *costs;	// NULL if switches are free
+	sweep_run_t *runs;
+	int num_runs;
+	int next_run;
+} sweep_t;
+
+void *sweep_worker(void *arg)
+{
+	sweep_t *sweep = arg;
+	simulator_job_list_t *jobs = malloc((sweep->num_jobs > 0 ? sweep->num_jobs : 1) * sizeof(simulator_job_list_t));
+	int run_id, i;
+
+	if (!jobs)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		exit(3);
+	}
+
+	while ((run_id = __sync_fetch_and_add(&sweep->next_run, 1)) < sweep->num_runs)
+	{
+		sweep_run_t *run = &sweep->runs[run_id];
+		int *quantum_clock = malloc(run->cores * sizeof(int));
+		core_diagram_t *diagrams = malloc(run->cores * sizeof(core_diagram_t));
+
+		if (!quantum_clock || !diagrams)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			exit(3);
+		}
+
+		for (i = 0; i < run->cores; i++)
+		{
+			quantum_clock[i] = -1;
+			diagram_init(&diagrams[i], 0, 0);
+		}
+
+		if (sweep->num_jobs > 0)
+			memcpy(jobs, sweep->jobs, sweep->num_jobs * sizeof(simulator_job_list_t));
+
+		scheduler_config_t config = *sweep->config;
+		apply_scheme_options(&config, &run->options);
+		scheduler_t *scheduler = scheduler_create(run->cores, run->scheme, &config);
+
+		switch_model_t switches;
+		if (sweep->costs)
+			switch_model_init(&switches, sweep->costs, scheduler, run->cores);
+
+		run->status = simulate_events(scheduler, jobs, sweep->num_jobs, NULL, run->cores, run->scheme, run->quantum,
+				quantum_clock, sweep->costs ? &switches : NULL, diagrams, 1);
+		run->waiting_time = scheduler_average_waiting_time_r(scheduler);
+		run->turnaround_time = scheduler_average_turnaround_time_r(scheduler);
+		run->response_time = scheduler_average_response_time_r(scheduler);
+		scheduler_destroy(scheduler);
+
+		run->switch_overhead = 0;
+		if (sweep->costs)
+		{
+			for (i = 0; i < run->cores; i++)
+				run->switch_overhead += switches.overhead[i];
+			switch_model_destroy(&switches);
+		}
+
+		for (i = 0; i < run->cores; i++)
+			diagram_destroy(&diagrams[i]);
+		free(diagrams);
+		free(quantum_clock);
+	}
+
+	free(jobs);
+	return NULL;
+}
+
+/*
+ * Runs the sweep over the comma-separated lists of core counts and schemes.
+ * Returns the exit status for main.
+ */
+int sweep(simulator_job_list_t *jobs, int num_jobs, const char *cores_list, const char *scheme_list, int threads,
+		const scheduler_config_t *config, const switch_costs_t *costs)
+{
+	int core_counts[SWEEP_MAX], schemes[SWEEP_MAX], quanta[SWEEP_MAX];
+	scheme_options_t options[SWEEP_MAX];
+	int num_cores = 0, num_schemes = 0, i, j, status = 0;
+	char *list, *item;
+
+	if ((list = strdup(cores_list)) == NULL)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		return 3;
+	}
+	for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ","))
+	{
+		if (num_cores == SWEEP_MAX || (core_counts[num_cores++] = atoi(item)) <= 0)
+		{
+			fprintf(stderr, "Option -c <cores> requires up to %d positive numbers.\n", SWEEP_MAX);
+			free(list);
+			return 1;
+		}
+	}
+	free(list);
+
+	if ((list = strdup(scheme_list)) == NULL)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		return 3;
+	}
+	for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ","))
+	{
+		if (num_schemes == SWEEP_MAX || parse_scheme(item, &schemes[num_schemes], &quanta[num_schemes], &options[num_schemes]) != 0)
+		{
+			fprintf(stderr, "Option -s <scheme> requires up to %d schemes, such as fcfs,rr2.\n", SWEEP_MAX);
+			free(list);
+			return 1;
+		}
+		num_schemes++;
+	}
+	free(list);
+
+	sweep_t state;
+	state.jobs = jobs;
+	state.num_jobs = num_jobs;
+	state.config = config;
+	state.costs = costs;
+	state.num_runs = num_cores * num_schemes;
+	state.next_run = 0;
+	state.runs = malloc(state.num_runs * sizeof(sweep_run_t));
+
+	if (threads > state.num_runs)
+		threads = state.num_runs;
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+
+	if (!state.runs || !workers)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		return 3;
+	}
+
+	for (i = 0; i < num_schemes; i++)
+	{
+		for (j = 0; j < num_cores; j++)
+		{
+			sweep_run_t *run = &state.runs[i * num_cores + j];
+			run->cores = core_counts[j];
+			run->scheme = schemes[i];
+			run->quantum = quanta[i];
+			run->options = options[i];
+		}
+	}
+
+	for (i = 0; i < threads; i++)
+	{
+		if (pthread_create(&workers[i], NULL, sweep_worker, &state) != 0)
+		{
+			fprintf(stderr, "Unable to start a thread.\n");
+			exit(3);
+		}
+	}
+	for (i = 0; i < threads; i++)
+		pthread_join(workers[i], NULL);
+
+	printf("scheme,cores,quantum,waiting_time,turnaround_time,response_time%s\n", costs ? ",switch_overhead" : "");
+	for (i = 0; i < state.num_runs; i++)
+	{
+		sweep_run_t *run = &state.runs[i];
+		if (run->status != 0)
+		{
+			fprintf(stderr, "Simulating %s with %d core(s) failed.\n", scheme_names[run->scheme], run->cores);
+			status = run->status;
+			continue;
+		}
+
+		printf("%s", scheme_names[run->scheme]);
+		print_scheme_options(&run->options);
+		printf(",%d,%d,%.2f,%.2f,%.2f", run->cores, run->quantum,
+				run->waiting_time, run->turnaround_time, run->response_time);
+		if (costs)
+			printf(",%lld", run->switch_overhead);
+		printf("\n");
+	}
+
+	free(workers);
+	free(state.runs);
+	return status;
+}
+
+
+int main(int argc, char **argv)
+{
+	int c;
+	int cores = 0, scheme = -1, quantum = 0, event_driven = 0, streaming = 0, quiet = 0, run_length = 0;
+	int sweep_threads = 0, per_core = 0, migration_cost = 0, percentiles = 0, switch_costly = 0;
+	switch_costs_t switch_costs;
+	scheme_options_t options = { { 0, { 0 }, 0 }, 0, 0 };
+	scheduler_config_t config;
+	char *cores_list = SWEEP_CORES, *scheme_list = SWEEP_SCHEMES;
+	char *file_name;
+
+	/*
+	 * Parse command line options.
+	 */
+	scheduler_config_default(&config);
+	while ((c = getopt(argc, argv, "c:s:b:p:m:x:eSqrPw:")) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				cores_list = optarg;
+				cores = atoi(optarg);
+
+				if (cores <= 0)
+				{
+					fprintf(stderr, "Option -c <cores> require a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 's':
+				scheme_list = optarg;
+				if (strchr(optarg, ',') == NULL && parse_scheme(optarg, &scheme, &quantum, &options) == -2)
+				{
+					if (scheme == MLFQ)
+						fprintf(stderr, "Option -s <scheme> requires up to %d positive quanta and a positive boost interval for MLFQ. (Eg: -s MLFQ2:4:8@100)\n", MLFQ_MAX_LEVELS);
+					else if (scheme == CFS)
+						fprintf(stderr, "Option -s <scheme> requires a positive granularity and latency for CFS. (Eg: -s CFS2:12)\n");
+					else
+						fprintf(stderr, "Option -s <scheme> requires a positive number for the quantum of RR. (Eg: -s RR2)\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'b':
+				if (strcasecmp(optarg, "HEAP") == 0) { config.queue_backend = QUEUE_HEAP; }
+				else if (strcasecmp(optarg, "BUCKET") == 0) { config.queue_backend = QUEUE_BUCKET; }
+				else
+				{
+					fprintf(stderr, "Option -b <queue> requires heap or bucket.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'p':
+			{
+				int steal, push_interval;
+				if (parse_balancing(optarg, &steal, &push_interval) != 0)
+				{
+					fprintf(stderr, "Option -p <balancing> requires none, steal or push# (Eg: -p steal,push10).\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				config.run_queues = RUNQUEUE_PER_CORE;
+				config.steal = steal;
+				config.push_interval = push_interval;
+				per_core = 1;
+				break;
+			}
+
+			case 'm':
+				migration_cost = atoi(optarg);
+
+				if (migration_cost < 0)
+				{
+					fprintf(stderr, "Option -m <cost> requires a number that is not negative.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'x':
+				switch_costly = 1;
+
+				if (parse_switch_costs(optarg, &switch_costs) != 0)
+				{
+					fprintf(stderr, "Option -x <costs> requires up to three numbers that are not negative, such as 1:2:5.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'e':
+				event_driven = 1;
+				break;
+
+			case 'S':
+				event_driven = 1;
+				streaming = 1;
+				break;
+
+			case 'q':
+				quiet = 1;
+				break;
+
+			case 'r':
+				run_length = 1;
+				break;
+
+			case 'P':
+				percentiles = 1;
+				break;
+
+			case 'w':
+				sweep_threads = atoi(optarg);
+
+				if (sweep_threads <= 0)
+				{
+					fprintf(stderr, "Option -w <threads> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case '?':
+				print_usage(argv[0]);
+				return 1;
+
+			default:
+				printf("....\n");
+				break;
+		}
+	}
+
+	if (cores == 0 && sweep_threads == 0)
+	{
+		fprintf(stderr, "Required option -c <cores> is not present.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (scheme == -1 && sweep_threads == 0)
+	{
+		fprintf(stderr, "Required option -s <scheme> is not present.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (sweep_threads == 0 && (strchr(cores_list, ',') != NULL || strchr(scheme_list, ',') != NULL))
+	{
+		fprintf(stderr, "Lists of cores or schemes are only accepted with -w <threads>.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (optind == argc - 1)
+		file_name = argv[optind];
+	else
+	{
+		fprintf(stderr, "A single input file is required.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+
+	/*
+	 * Open the file, read the file, and populate the jobs data structure.
+	 */
+	trace_t trace;
+	int opened = trace_open(&trace, file_name);
+	if (opened == -1)
+	{
+		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+		return 2;
+	}
+	else if (opened != 0)
+	{
+		fprintf(stderr, "Illegal file format.\n");
+		return 2;
+	}
+
+
+	// A streamed trace is read as the simulation goes; only count its jobs here
+	int job_id = 0, deadlines = trace.deadlines;
+	int jobs_ct = trace_count(&trace);
+	simulator_job_list_t* jobs = NULL;
+
+	if (streaming && sweep_threads == 0)
+		job_id = jobs_ct;
+	else
+	{
+		jobs = malloc((jobs_ct > 0 ? jobs_ct : 1) * sizeof(simulator_job_list_t));
+		if (!jobs)
+		{
+			fprintf(stderr, "Out of memory.\n");
+			return 2;
+		}
+
+		trace_job_t job;
+		int result;
+		while ((result = trace_next(&trace, &job)) == 1)
+		{
+			jobs[job_id].job_id = job_id;
+			jobs[job_id].arrival_time = job.arrival_time;
+			jobs[job_id].run_time = job.run_time;
+			jobs[job_id].priority = job.priority;
+			jobs[job_id].deadline = job.deadline;
+			jobs[job_id].core_id = -1;
+			jobs[job_id].arrived = 0;
+			jobs[job_id].last_core = -1;
+
+			job_id++;
+		}
+
+		if (result == -1)
+		{
+			fprintf(stderr, "Illegal file format.\n");
+			return 2;
+		}
+
+		trace_close(&trace);
+	}
+
+	if (sweep_threads > 0)
+	{
+		int status = sweep(jobs, job_id, cores_list, scheme_list, sweep_threads, &config, switch_costly ? &switch_costs : NULL);
+		free(jobs);
+		return status;
+	}
+
+
+	/*
+	 * Run the simulation.
+	 */
+
+	if (!quiet)
+	{
+		printf("Loaded %d core(s) and %d job(s) using ", cores, job_id);
+		if (scheme == FCFS) { printf("First Come First Served (FCFS)"); }
+		else if (scheme == SJF) { printf("Non-preemptive Shortest Job First (SJF)"); }
+		else if (scheme == PSJF) { printf("Preemptive Shortest Job First (PSJF)"); }
+		else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
+		else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
+		else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
+		else if (scheme == MLFQ && options.mlfq.levels > 0) { printf("Multilevel Feedback Queue (MLFQ) with quanta of "); print_scheme_options(&options); }
+		else if (scheme == MLFQ) { printf("Multilevel Feedback Queue (MLFQ)"); }
+		else if (scheme == CFS && options.cfs_granularity > 0) { printf("Completely Fair Scheduler (CFS) with a granularity and latency of "); print_scheme_options(&options); }
+		else if (scheme == CFS) { printf("Completely Fair Scheduler (CFS)"); }
+		else if (scheme == EDF) { printf("Earliest Deadline First (EDF)"); }
+		else if (scheme == RM) { printf("Rate Monotonic (RM)"); }
+		printf(" scheduling...\n\n");
+	}
+
+	apply_scheme_options(&config, &options);
+	scheduler_start_up_r(scheduler_default(), cores, scheme, &config);
+
+
+	int time = 0, i, j;
+	int active_jobs = job_id, jobs_alive = 0;
+
+	int *quantum_clock = malloc(cores * sizeof(int));
+	core_diagram_t *core_timing_diagram = malloc(cores * sizeof(core_diagram_t));
+
+	switch_model_t switch_model, *switches = NULL;
+	if (switch_costly)
+	{
+		switch_model_init(&switch_model, &switch_costs, scheduler_default(), cores);
+		switches = &switch_model;
+	}
+
+	for (i = 0; i < cores; i++)
+	{
+		quantum_clock[i] = -1;
+		diagram_init(&core_timing_diagram[i], !quiet && !run_length, run_length);
+	}
+
+	if (event_driven)
+	{
+		int status = simulate_events(scheduler_default(), jobs, active_jobs, streaming ? &trace : NULL, cores, scheme, quantum,
+				quantum_clock, switches, core_timing_diagram, quiet);
+		if (streaming)
+			trace_close(&trace);
+		if (status != 0)
+			return status;
+	}
+
+	while (!event_driven && active_jobs > 0)
+	{
+		if (!quiet)
+			printf("=== [TIME %d] ===\n", time);
+
+		/*
+		 * 1. Check if any jobs finished in the last time unit.
+		 */
+		for (i = 0; i < active_jobs; i++)
+		{
+			if (jobs[i].run_time == 0)
+			{
+				// Notify the scheduler has finished
+				int job_id = jobs[i].job_id;
+				int core_id = jobs[i].core_id;
+				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
+
+				if (TIME_SLICED(scheme))
+					quantum_clock[core_id] = next_quantum(scheduler_default(), scheme, quantum, core_id);
+
+				// Delete the finished jobs, decrease the number of active jobs
+				if (i != active_jobs - 1)
+					memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(simulator_job_list_t));
+				active_jobs--;
+				jobs_alive--;
+				i--;
+
+				// Set the new job
+				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs, switches, quantum_clock) )
+				{
+					printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
+					print_available_jobs(jobs, active_jobs);
+					return 3;
+				}
+				else if (!quiet)
+				{
+					printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+				}
+			}
+		}
+
+		/*
+		 * Check to see if we finished our last job.  (If we don't check here, we would run an extra time unit that will be totally idle.)
+		 */
+		if (active_jobs == 0)
+			break;
+
+		/*
+		 * 2. Check of any quantums expired in the last time unit.
+		 */
+		if (TIME_SLICED(scheme))
+		{
+			for (i = 0; i < cores; i++)
+			{
+				if (quantum_clock[i] == 0)
+				{
+					for (j = 0; j < active_jobs; j++)
+					{
+						if (jobs[j].core_id == i)
+						{
+							// Notify the scheduler the quantum has expired
+							int core_id = jobs[j].core_id;
+							int old_job_id = jobs[j].job_id;
+							int new_job_id = scheduler_quantum_expired(jobs[j].core_id, time);
+
+							jobs[j].core_id = -1;
+
+							quantum_clock[core_id] = next_quantum(scheduler_default(), scheme, quantum, core_id);
+
+							// Set the new job
+							if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs, switches, quantum_clock) )
+							{
+								printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
+								print_available_jobs(jobs, active_jobs);
+								return 3;
+							}
+							else if (!quiet)
+							{
+								printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
+								printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+							}
+
+							break;
+						}
+					}
+				}
+			}
+		}
+
+
+		/*
+		 * 3. Check for any new jobs that arrive in this time unit
+		 */
+		for (i = 0; i < active_jobs; i++)
+		{
+			if (jobs[i].arrival_time == time)
+			{
+				int new_job_core_id = scheduler_new_deadline_job(jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority, jobs[i].deadline);
+				jobs[i].arrived = 1;
+				jobs_alive++;
+
+				if (new_job_core_id >= 0 && new_job_core_id < cores)
+				{
+					if (!quiet)
+					{
+						printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+								jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
+						printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+					}
+
+					// Find if anyone is currently using the core.
+					for (j = 0; j < active_jobs; j++)
+						if (jobs[j].core_id == new_job_core_id)
+							jobs[j].core_id = -1;
+
+					// Assign the core to the new job
+					jobs[i].core_id = new_job_core_id;
+
+					if (TIME_SLICED(scheme))
+						quantum_clock[new_job_core_id] = next_quantum(scheduler_default(), scheme, quantum, new_job_core_id);
+					charge_switch(switches, &jobs[i], new_job_core_id, quantum_clock);
+				}
+				else if (new_job_core_id == -1)
+				{
+					if (!quiet)
+					{
+						printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+								jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
+						printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+					}
+				}
+				else
+				{
+					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
+					print_available_cores(cores);
+					return 3;
+				}
+			}
+		}
+
+
+		/*
+		 * 4. Run the time unit.
+		 */
+		int core_job_id[cores];
+		int cores_working = 0;
+
+		for (i = 0; i < cores; i++)
+			core_job_id[i] = -1;
+
+		for (i = 0; i < active_jobs; i++)
+		{
+			if (jobs[i].core_id != -1)
+			{
+				cores_working++;
+				jobs[i].run_time--;
+				quantum_clock[jobs[i].core_id]--;
+
+				assert(core_job_id[jobs[i].core_id] == -1);
+
+				core_job_id[jobs[i].core_id] = jobs[i].job_id;
+			}
+		}
+
+		// An idle core shows up as a '-'
+		for (i = 0; i < cores; i++)
+			diagram_append(&core_timing_diagram[i], core_job_id[i], 1);
+
+
+		/*
+		 * 5. Print data!
+		 */
+		if (!quiet)
+		{
+			printf("At the end of time unit %d...\n", time);
+
+			for (i = 0; i < cores; i++)
+			{
+				printf("  Core %2d: ", i);
+				diagram_print(&core_timing_diagram[i]);
+				printf("\n");
+			}
+
+			printf("\n");
+
+			printf("  Queue: ");
+			scheduler_show_queue();
+			printf("\n");
+			printf("\n");
+		}
+
+
+		/*
+		 * 6. Sanity Checking
+		 *
+		 * - If there's a job alive (needing to be ran) and all CPUs are idle, the scheduler failed to schedule properly.
+		 */
+		if (jobs_alive > 0 && cores_working == 0)
+		{
+			printf("All cores are idle and at least one job remains unscheduled.\n");
+			print_available_jobs(jobs, active_jobs);
+			return 3;
+		}
+
+
+		/*
+		 * 7. Increase time
+		 */
+		time++;
+	}
+
+
+	if (!quiet || run_length)
+	{
+		printf("FINAL TIMING DIAGRAM:\n");
+		for (i = 0; i < cores; i++)
+		{
+			printf("  Core %2d: ", i);
+			diagram_print(&core_timing_diagram[i]);
+			printf("\n");
+		}
+
+		printf("\n");
+	}
+	if (per_core)
+	{
+		printf("Migrations: %d\n", scheduler_migrations());
+		printf("Migration Cost: %lld\n", (long long)scheduler_migrations() * migration_cost);
+	}
+	if (switches)
+		print_switch_overhead(switches, cores);
+	if (percentiles)
+	{
+		print_percentiles("Waiting Time", METRIC_WAITING);
+		print_percentiles("Turnaround Time", METRIC_TURNAROUND);
+		print_percentiles("Response Time", METRIC_RESPONSE);
+	}
+	if (deadlines)
+	{
+		printf("Deadline Miss Rate: %.2f%%\n", scheduler_deadline_miss_rate() * 100);
+		printf("Lateness p50: %d p90: %d p99: %d Max: %d\n", scheduler_lateness_percentile(50),
+				scheduler_lateness_percentile(90), scheduler_lateness_percentile(99), scheduler_lateness_percentile(100));
+	}
+	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time());
+	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
+	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
+
+	scheduler_clean_up();
+
+	if (switches)
+		switch_model_destroy(switches);
+
+	free(quantum_clock);
+	for (i=0; i < cores; i++)
+		diagram_destroy(&core_timing_diagram[i]);
+	free(core_timing_diagram);
+	free(jobs);
+
+	return 0;
+}
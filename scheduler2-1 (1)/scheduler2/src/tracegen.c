@@ -0,0 +1,546 @@
+/** @file tracegen.c
+
+  Generates synthetic traces for stress testing the simulator and
+  libpriqueue: jobs with random arrival gaps, run times and priorities
+  drawn from the distributions given on the command line. The same seed
+  always gives the same trace.
+
+  libscheduler expects every job to arrive at a different time, so each
+  arrival is at least one time unit after the one before it, even where
+  the drawn gaps are shorter (as within a burst, whose default gap is 0).
+
+  The trace is written as CSV, or with -B as a binary trace (see
+  trace_header_t). The binary format stores one column after another, so
+  the jobs are generated again for every column instead of being held in
+  memory, however many there are.
+
+  Usage: tracegen [-n <jobs>] [-s <seed>] [-a <arrivals>] [-r <run times>]
+                  [-p <priorities>] [-d <slack>] [-B] <output file>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "libtrace/libtrace.h"
+
+#define GEN_BUFFER 4096
+#define GEN_MAX_PRIORITIES 64
+
+typedef enum {ARRIVE_POISSON = 0, ARRIVE_BURSTY, ARRIVE_FIXED} arrival_kind_t;
+typedef enum {RUN_EXP = 0, RUN_PARETO, RUN_BIMODAL, RUN_UNIFORM} run_kind_t;
+
+/**
+  What to generate. Arrival gaps and run times are described by a kind and
+  up to three parameters, whose meaning depends on the kind (see
+  print_usage()).
+*/
+typedef struct _gen_config_t
+{
+  long jobs;
+  uint64_t seed;
+  arrival_kind_t arrival;
+  double arrival_args[3];
+  run_kind_t run;
+  double run_args[3];
+  double priority_weights[GEN_MAX_PRIORITIES];
+  int priorities;
+  double slack;
+} gen_config_t;
+
+/**
+  Generator state. xoshiro256** seeded through splitmix64, so traces come
+  out the same on every libc.
+*/
+typedef struct _gen_t
+{
+  const gen_config_t *config;
+  uint64_t state[4];
+  double clock;
+  int burst_left;
+  long long last_arrival;
+} gen_t;
+
+
+static uint64_t splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t gen_next(gen_t *g)
+{
+  uint64_t *s = g->state;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+/* Uniform in (0, 1], so it can be passed to log(). */
+static double gen_uniform(gen_t *g)
+{
+  return ((gen_next(g) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double gen_exponential(gen_t *g, double mean)
+{
+  return -mean * log(gen_uniform(g));
+}
+
+static void gen_start(gen_t *g, const gen_config_t *config)
+{
+  uint64_t x = config->seed;
+  int i;
+
+  g->config = config;
+  for(i = 0; i < 4; i++)
+    g->state[i] = splitmix64(&x);
+  g->clock = 0.0;
+  g->burst_left = 0;
+  g->last_arrival = -1;
+}
+
+/**
+  Time until the next job arrives. Bursty arrivals come in bursts of about
+  arrival_args[1] jobs, arrival_args[2] apart, with exponential quiet
+  periods of mean arrival_args[0] between the bursts.
+ */
+static double gen_gap(gen_t *g)
+{
+  const double *args = g->config->arrival_args;
+
+  switch(g->config->arrival)
+  {
+    case ARRIVE_POISSON:
+      return gen_exponential(g, args[0]);
+
+    case ARRIVE_BURSTY:
+      if(g->burst_left > 0)
+      {
+        g->burst_left--;
+        return args[2];
+      }
+      g->burst_left = (int)gen_exponential(g, args[1]);
+      return gen_exponential(g, args[0]);
+
+    default:
+      return args[0];
+  }
+}
+
+static double gen_run_time(gen_t *g)
+{
+  const double *args = g->config->run_args;
+
+  switch(g->config->run)
+  {
+    case RUN_EXP:
+      return gen_exponential(g, args[0]);
+
+    case RUN_PARETO:
+      return args[1] / pow(gen_uniform(g), 1.0 / args[0]);
+
+    case RUN_BIMODAL:
+      return gen_uniform(g) <= args[2] ? gen_exponential(g, args[1]) : gen_exponential(g, args[0]);
+
+    default:
+      return args[0] + (args[1] - args[0] + 1) * (1.0 - gen_uniform(g));
+  }
+}
+
+static int gen_priority(gen_t *g)
+{
+  const gen_config_t *config = g->config;
+  double total = 0.0, pick;
+  int i;
+
+  if(config->priorities == 1)
+    return 0;
+
+  for(i = 0; i < config->priorities; i++)
+    total += config->priority_weights[i];
+  pick = gen_uniform(g) * total;
+  for(i = 0; i < config->priorities - 1; i++)
+  {
+    pick -= config->priority_weights[i];
+    if(pick <= 0.0)
+      break;
+  }
+  return i;
+}
+
+static int clamp_time(double value)
+{
+  if(value < 1.0)
+    return 1;
+  if(value >= INT_MAX)
+    return INT_MAX;
+  return (int)value;
+}
+
+/**
+  Generates the next job. Every field is drawn whether or not it is
+  written, so each pass over the trace sees the same jobs.
+
+  @return 0 on success
+  @return -1 if arrival times no longer fit in an int
+ */
+static int gen_job(gen_t *g, trace_job_t *job)
+{
+  g->clock += gen_gap(g);
+  if(g->clock >= INT_MAX)
+    return -1;
+
+  // Arrival times are strictly increasing, whatever the gaps were
+  long long arrival = (long long)g->clock;
+  if(arrival <= g->last_arrival)
+    arrival = g->last_arrival + 1;
+  if(arrival > INT_MAX)
+    return -1;
+  g->last_arrival = arrival;
+
+  job->arrival_time = (int)arrival;
+  job->run_time = clamp_time(gen_run_time(g));
+  job->priority = gen_priority(g);
+  job->deadline = g->config->slack > 0.0 ? clamp_time(ceil(job->run_time * g->config->slack)) : 0;
+  return 0;
+}
+
+static int write_csv(const gen_config_t *config, FILE *out)
+{
+  gen_t g;
+  trace_job_t job;
+  long i;
+
+  gen_start(&g, config);
+  fprintf(out, "\"Arrival time\",\"Run time\",\"Priority\"%s\n", config->slack > 0.0 ? ",\"Deadline\"" : "");
+  for(i = 0; i < config->jobs; i++)
+  {
+    if(gen_job(&g, &job) != 0)
+      return -1;
+    if(config->slack > 0.0)
+      fprintf(out, "%d,%d,%d,%d\n", job.arrival_time, job.run_time, job.priority, job.deadline);
+    else
+      fprintf(out, "%d,%d,%d\n", job.arrival_time, job.run_time, job.priority);
+  }
+  return ferror(out) ? -2 : 0;
+}
+
+static int flush_values(int32_t *buffer, int used, FILE *out, uint64_t *hash)
+{
+  *hash = trace_checksum(*hash, buffer, used);
+  return fwrite(buffer, sizeof(int32_t), used, out) == (size_t)used ? 0 : -2;
+}
+
+/**
+  Writes one column of a binary trace, adding it to the checksum.
+
+  @return 0 on success
+  @return -1 if arrival times no longer fit in an int
+  @return -2 if the output cannot be written
+ */
+static int write_column(const gen_config_t *config, int column, FILE *out, uint64_t *hash)
+{
+  int32_t buffer[GEN_BUFFER];
+  int used = 0;
+  gen_t g;
+  trace_job_t job;
+  long i;
+
+  gen_start(&g, config);
+  for(i = 0; i < config->jobs; i++)
+  {
+    if(gen_job(&g, &job) != 0)
+      return -1;
+
+    if(column == 0)
+      buffer[used++] = job.arrival_time;
+    else if(column == 1)
+      buffer[used++] = job.run_time;
+    else if(column == 2)
+      buffer[used++] = job.priority;
+    else
+      buffer[used++] = job.deadline;
+
+    if(used == GEN_BUFFER)
+    {
+      if(flush_values(buffer, used, out, hash) != 0)
+        return -2;
+      used = 0;
+    }
+  }
+  return flush_values(buffer, used, out, hash);
+}
+
+static int write_binary(const gen_config_t *config, FILE *out)
+{
+  trace_header_t header;
+  int column, result = 0;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.columns = config->slack > 0.0 ? TRACE_COLUMNS : TRACE_BASE_COLUMNS;
+  header.count = config->jobs;
+  header.checksum = TRACE_CHECKSUM_SEED;
+
+  // The header is written again once the checksum is known
+  if(fwrite(&header, sizeof(header), 1, out) != 1)
+    result = -2;
+  for(column = 0; column < (int)header.columns && result == 0; column++)
+    result = write_column(config, column, out, &header.checksum);
+
+  if(result == 0 && (fseek(out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, out) != 1))
+    result = -2;
+  return result;
+}
+
+/**
+  A distribution that can be named on the command line, with the most
+  parameters it takes and their defaults.
+*/
+typedef struct _gen_kind_t
+{
+  const char *name;
+  int max_args;
+  double defaults[3];
+} gen_kind_t;
+
+static const gen_kind_t arrival_kinds[] = {
+  { "poisson", 1, { 10.0 } },
+  { "bursty",  3, { 10.0, 8.0, 0.0 } },
+  { "fixed",   1, { 10.0 } },
+};
+
+static const gen_kind_t run_kinds[] = {
+  { "exp",     1, { 10.0 } },
+  { "pareto",  2, { 1.5, 2.0 } },
+  { "bimodal", 3, { 5.0, 100.0, 0.1 } },
+  { "uniform", 2, { 1.0, 20.0 } },
+};
+
+/**
+  Parses "<name>[:<number>...]" for one of the num_kinds kinds, filling
+  args with the numbers given and the kind's defaults for the rest.
+
+  @return the index of the kind, or -1 if spec is malformed
+ */
+static int parse_kind(const char *spec, const gen_kind_t *kinds, int num_kinds, double *args)
+{
+  char *end;
+  int kind, count = 0;
+
+  for(kind = 0; kind < num_kinds; kind++)
+  {
+    size_t length = strlen(kinds[kind].name);
+    if(strncasecmp(spec, kinds[kind].name, length) == 0 && (spec[length] == '\0' || spec[length] == ':'))
+      break;
+  }
+  if(kind == num_kinds)
+    return -1;
+
+  memcpy(args, kinds[kind].defaults, sizeof(kinds[kind].defaults));
+  spec += strlen(kinds[kind].name);
+  while(*spec == ':')
+  {
+    if(count == kinds[kind].max_args)
+      return -1;
+    args[count] = strtod(spec + 1, &end);
+    if(end == spec + 1 || !(args[count] >= 0.0))
+      return -1;
+    count++;
+    spec = end;
+  }
+  return *spec == '\0' ? kind : -1;
+}
+
+static int parse_arrivals(const char *spec, gen_config_t *config)
+{
+  int kind = parse_kind(spec, arrival_kinds, sizeof(arrival_kinds) / sizeof(arrival_kinds[0]), config->arrival_args);
+  if(kind == -1)
+    return -1;
+  config->arrival = kind;
+  return 0;
+}
+
+static int parse_run_times(const char *spec, gen_config_t *config)
+{
+  double *args = config->run_args;
+  int kind = parse_kind(spec, run_kinds, sizeof(run_kinds) / sizeof(run_kinds[0]), args);
+  if(kind == -1)
+    return -1;
+  config->run = kind;
+
+  if((kind == RUN_PARETO && args[0] <= 0.0) || (kind == RUN_BIMODAL && args[2] > 1.0)
+     || (kind == RUN_UNIFORM && args[1] < args[0]))
+    return -1;
+  return 0;
+}
+
+/* Parses the weights of priorities 0, 1, ... separated by colons. */
+static int parse_priorities(const char *spec, gen_config_t *config)
+{
+  double total = 0.0;
+  char *end;
+
+  config->priorities = 0;
+  while(1)
+  {
+    if(config->priorities == GEN_MAX_PRIORITIES)
+      return -1;
+    double weight = strtod(spec, &end);
+    if(end == spec || !(weight >= 0.0))
+      return -1;
+    config->priority_weights[config->priorities++] = weight;
+    total += weight;
+
+    spec = end;
+    if(*spec != ':')
+      break;
+    spec++;
+  }
+  return *spec == '\0' && total > 0.0 ? 0 : -1;
+}
+
+static void print_usage(char *program_name)
+{
+  fprintf(stderr, "Usage: %s [-n <jobs>] [-s <seed>] [-a <arrivals>] [-r <run times>] [-p <priorities>] [-d <slack>] [-B] <output file>\n", program_name);
+  fprintf(stderr, "  -n  number of jobs (default 1000000)\n");
+  fprintf(stderr, "  -s  seed; the same seed gives the same trace (default 1)\n");
+  fprintf(stderr, "  -a  gaps between arrivals, at least 1 apart whatever is drawn, one of (default poisson:10):\n");
+  fprintf(stderr, "        poisson[:<mean gap>]\n");
+  fprintf(stderr, "        bursty[:<mean quiet gap>[:<mean burst size>[:<gap in a burst>]]] (default bursty:10:8:0)\n");
+  fprintf(stderr, "        fixed[:<gap>]\n");
+  fprintf(stderr, "  -r  run times, one of (default exp:10):\n");
+  fprintf(stderr, "        exp[:<mean>]\n");
+  fprintf(stderr, "        pareto[:<shape>[:<minimum>]] (default pareto:1.5:2)\n");
+  fprintf(stderr, "        bimodal[:<short mean>[:<long mean>[:<fraction long>]]] (default bimodal:5:100:0.1)\n");
+  fprintf(stderr, "        uniform[:<minimum>[:<maximum>]] (default uniform:1:20)\n");
+  fprintf(stderr, "  -p  relative weights of priorities 0, 1, ..., separated by colons (default 1: all 0)\n");
+  fprintf(stderr, "  -d  adds a deadline column of <slack> times each job's run time\n");
+  fprintf(stderr, "  -B  writes a binary trace instead of CSV\n");
+}
+
+int main(int argc, char **argv)
+{
+  gen_config_t config;
+  int c, binary = 0, result;
+
+  memset(&config, 0, sizeof(config));
+  config.jobs = 1000000;
+  config.seed = 1;
+  parse_arrivals("poisson", &config);
+  parse_run_times("exp", &config);
+  parse_priorities("1", &config);
+
+  while((c = getopt(argc, argv, "n:s:a:r:p:d:B")) != -1)
+  {
+    switch(c)
+    {
+      case 'n':
+        config.jobs = atol(optarg);
+        if(config.jobs < 0 || config.jobs > INT_MAX)
+        {
+          fprintf(stderr, "Option -n <jobs> requires a number from 0 to %d.\n", INT_MAX);
+          return 1;
+        }
+        break;
+
+      case 's':
+        config.seed = strtoull(optarg, NULL, 10);
+        break;
+
+      case 'a':
+        if(parse_arrivals(optarg, &config) != 0)
+        {
+          fprintf(stderr, "Unknown arrival distribution \"%s\".\n", optarg);
+          print_usage(argv[0]);
+          return 1;
+        }
+        break;
+
+      case 'r':
+        if(parse_run_times(optarg, &config) != 0)
+        {
+          fprintf(stderr, "Unknown run time distribution \"%s\".\n", optarg);
+          print_usage(argv[0]);
+          return 1;
+        }
+        break;
+
+      case 'p':
+        if(parse_priorities(optarg, &config) != 0)
+        {
+          fprintf(stderr, "Option -p <priorities> requires weights that are not negative, such as 1:2:1.\n");
+          print_usage(argv[0]);
+          return 1;
+        }
+        break;
+
+      case 'd':
+        config.slack = atof(optarg);
+        if(config.slack <= 0.0)
+        {
+          fprintf(stderr, "Option -d <slack> requires a positive number.\n");
+          return 1;
+        }
+        break;
+
+      case 'B':
+        binary = 1;
+        break;
+
+      default:
+        print_usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if(optind != argc - 1)
+  {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  FILE *out = fopen(argv[optind], "wb");
+  if(out == NULL)
+  {
+    fprintf(stderr, "Unable to open file \"%s\".\n", argv[optind]);
+    return 2;
+  }
+
+  result = binary ? write_binary(&config, out) : write_csv(&config, out);
+  if(fclose(out) != 0 && result == 0)
+    result = -2;
+
+  if(result != 0)
+  {
+    if(result == -1)
+      fprintf(stderr, "Arrival times run past %d; use fewer jobs or shorter gaps.\n", INT_MAX);
+    else
+      fprintf(stderr, "Unable to write file \"%s\".\n", argv[optind]);
+    remove(argv[optind]);
+    return 2;
+  }
+
+  return 0;
+}